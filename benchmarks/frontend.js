@@ -0,0 +1,146 @@
+/*
+	times the compiler's front end (lexing, parsing & bundling) on a large
+	generated program, reporting tokens & AST nodes per second.
+
+	  $ node benchmarks/frontend.js [--functions 2000] [--runs 10] [--json]
+
+	`--functions` sets the size of the program, each function is ~25 lines.
+	the program is made up of the constructs the examples use: functions,
+	loops, objects, lists, strings with interpolation & comments.
+*/
+
+const { Lexer } = require('../src/lexer')
+const { Parser } = require('../src/parser')
+const { bundle } = require('../src/bundler')
+const { Token } = require('../src/token')
+
+const args = process.argv.slice(2)
+
+function option(flag, fallback) {
+	return args.includes(flag) ? Number(args[args.indexOf(flag) + 1]) : fallback
+}
+
+function generate(functions) {
+	let source = []
+
+	for (let i = 0; i < functions; i++) {
+		source.push(`// function number ${i}
+fn compute${i}(items, scale) {
+    let total = 0
+    let shape = {kind: "rect", width: ${i}, height: scale * 2.5}
+    for item in items {
+        if item > 10 and item <= 1000 or !(item == ${i}) {
+            total = total + item * scale - (item / 3)
+        } else {
+            total = total - 1
+        }
+    }
+
+    let names = ["a", "b", "c${i}", "d"]
+    let i = 0
+    while i < len(names) {
+        names[i] = "\${names[i]} is number \${toString(i)}"
+        i = i + 1
+    }
+
+    shape.area = fn() {
+        return shape.width * shape.height
+    }
+    print "compute${i}: \${toString(total)}"
+    return total + shape.area()
+}
+
+let result${i} = compute${i}(0..100, ${i % 7})
+`)
+	}
+
+	return source.join('\n')
+}
+
+// tokens have a type too, but only count the nodes made by the parser
+function countNodes(node) {
+	if (Array.isArray(node)) {
+		return node.reduce((count, child) => count + countNodes(child), 0)
+	}
+	if (!node || typeof node !== 'object' || !('type' in node)) return 0
+	if (node instanceof Token) return 0
+
+	let count = 1
+	for (const key in node) count += countNodes(node[key])
+	return count
+}
+
+function time(fn) {
+	const start = process.hrtime.bigint()
+	const result = fn()
+	return [result, Number(process.hrtime.bigint() - start) / 1e6]
+}
+
+function median(times) {
+	const sorted = [...times].sort((a, b) => a - b)
+	const middle = Math.floor(sorted.length / 2)
+	return sorted.length % 2 === 0
+		? (sorted[middle - 1] + sorted[middle]) / 2
+		: sorted[middle]
+}
+
+function benchmark(source, runs) {
+	let times = { lex: [], parse: [], bundle: [] }
+	let tokens = null
+	let nodes = null
+
+	// the first run warms up the JIT & isn't measured
+	for (let run = 0; run <= runs; run++) {
+		const [scanned, lexTime] = time(() => new Lexer(source).scanTokens())
+		const [ast, parseTime] = time(() => new Parser(scanned).parse())
+		const [bundled, bundleTime] = time(() => bundle(ast, __filename))
+
+		if (run === 0) {
+			tokens = scanned.length
+			nodes = countNodes(bundled)
+			continue
+		}
+
+		times.lex.push(lexTime)
+		times.parse.push(parseTime)
+		times.bundle.push(bundleTime)
+	}
+
+	const lex = median(times.lex)
+	const parse = median(times.parse)
+	const bundleTime = median(times.bundle)
+	return {
+		bytes: source.length,
+		tokens,
+		nodes,
+		lex_ms: lex,
+		parse_ms: parse,
+		bundle_ms: bundleTime,
+		total_ms: lex + parse + bundleTime,
+		tokens_per_sec: Math.round(tokens / (lex / 1000)),
+		nodes_per_sec: Math.round(nodes / (parse / 1000)),
+	}
+}
+
+const functions = option('--functions', 2000)
+const runs = option('--runs', 10)
+const result = benchmark(generate(functions), runs)
+
+if (args.includes('--json')) {
+	console.log(JSON.stringify({ date: new Date(), functions, ...result }))
+} else {
+	console.log(
+		`${functions} functions, ${(result.bytes / 1024).toFixed(0)} KiB, ` +
+			`${result.tokens} tokens, ${result.nodes} nodes`
+	)
+	console.log(
+		`lex    ${result.lex_ms.toFixed(1).padStart(8)} ms ` +
+			`${result.tokens_per_sec.toLocaleString('en-US')} tokens/s`
+	)
+	console.log(
+		`parse  ${result.parse_ms.toFixed(1).padStart(8)} ms ` +
+			`${result.nodes_per_sec.toLocaleString('en-US')} nodes/s`
+	)
+	console.log(`bundle ${result.bundle_ms.toFixed(1).padStart(8)} ms`)
+	console.log(`total  ${result.total_ms.toFixed(1).padStart(8)} ms`)
+}
@@ -1,11 +1,15 @@
 const { walk } = require('./walk')
 const { Environment } = require('./environment')
 const { builtins } = require('./builtins')
+const { createCounter } = require('./util')
 
 let compilingC = true
 let inFunction = null
 let currentDepth = 0
-let closureCaptures = new Set()
+
+// the names of the generated C functions
+const funcMangleCount = createCounter(0)
+const anonymousFnCount = createCounter(0)
 
 let env = new Environment()
 
@@ -13,89 +17,138 @@ builtins.forEach((builtin) => {
 	env.define(builtin, null, false)
 })
 
-function analyzeBlock({ statements }, localEnvironment, localClosureCaptures) {
-	let prevCaptures = closureCaptures
+// kept around to tell uses of the builtins apart from variables shadowing them
+const builtinBindings = { ...env.values }
+
+// the binding `name` refers to, `undefined` if it isn't declared (yet)
+function lookup(name) {
+	for (let scope = env; scope !== null; scope = scope.enclosing) {
+		if (name in scope.values) return scope.values[name]
+	}
+}
+
+function isBuiltinCall(node, name) {
+	return (
+		node.type === 'CallExpression' &&
+		node.callee.type === 'VariableExpression' &&
+		node.callee.ident.lexeme === name &&
+		env.get(name).value === builtinBindings[name]
+	)
+}
+
+function analyzeBlock({ statements }, localEnvironment) {
 	let prevEnvironment = env
 
 	env = localEnvironment
-	closureCaptures = localClosureCaptures
 	currentDepth++
 	statements = statements.map((stmt) => analyze(stmt, compilingC))
 	currentDepth--
 	env = prevEnvironment
-	closureCaptures = prevCaptures
 
 	return statements
 }
 
+/*
+	records that `func` uses a variable declared outside of it (at `depth`).
+	functions nested in between capture it as well, since the inner closure
+	is created from their environment.
+*/
+function capture(func, binding, name, depth) {
+	for (; func && depth <= func.depth; func = func.parent) {
+		if (func.captures.some((captured) => captured.binding === binding)) {
+			return
+		}
+
+		func.captures.push({ binding, name })
+		binding.captured = true
+		binding.capturedBy = (binding.capturedBy || []).concat(func)
+	}
+}
+
+function declaration(ident, initializer, type) {
+	const binding = env.values[ident.lexeme]
+	initializer = analyze(initializer, compilingC)
+
+	// calls through variables holding a function literal can be resolved too
+	if (initializer && initializer.type === 'FunctionExpression') {
+		binding.func = initializer.func
+		initializer.func.binding = binding
+	}
+
+	return { ident, initializer, binding, type }
+}
+
 const analyzeVisitor = {
 	// decls
 	FunctionDeclaration: (ident, parameters, body) => {
 		const func = {
+			name: ident.lexeme + funcMangleCount(),
 			closure: new Environment(env).clone(),
 			arity: () => parameters.length,
 			captures: [],
 			depth: currentDepth,
+			parent: inFunction,
 		}
 
 		func.closure.define(ident.lexeme, null, false)
+		func.self = func.closure.values[ident.lexeme]
+		func.self.func = func
 
 		parameters.forEach((param) => {
 			func.closure.define(param.lexeme, null, true)
 		})
+		func.parameterBindings = parameters.map(
+			(param) => func.closure.values[param.lexeme]
+		)
 
+		let prevFunction = inFunction
 		inFunction = func
 
-		let funcCaptures = new Set()
-		body.statements = analyzeBlock(body, func.closure, funcCaptures)
-		func.captures = Array.from(funcCaptures)
+		body.statements = analyzeBlock(body, func.closure)
 
 		env.define(ident.lexeme, func)
+		func.binding = env.values[ident.lexeme]
+		func.binding.func = func
 
-		inFunction = null
+		inFunction = prevFunction
 
 		return {
 			ident,
 			parameters,
 			body,
 			func,
+			binding: env.values[ident.lexeme],
 			type: 'FunctionDeclaration',
 		}
 	},
 	VariableDeclaration: (ident, initializer) => {
 		env.define(ident.lexeme, null, true)
-		return {
-			ident,
-			initializer: analyze(initializer, compilingC),
-			type: 'VariableDeclaration',
-		}
+		return declaration(ident, initializer, 'VariableDeclaration')
 	},
 	ConstantDeclaration: (ident, initializer) => {
 		env.define(ident.lexeme, null, false)
-		return {
-			ident,
-			initializer: analyze(initializer, compilingC),
-			type: 'ConstantDeclaration',
-		}
+		return declaration(ident, initializer, 'ConstantDeclaration')
 	},
 
 	// stmts
 	Block: (statements) => {
 		return {
-			statements: analyzeBlock(
-				{ statements },
-				new Environment(env),
-				closureCaptures
-			),
+			statements: analyzeBlock({ statements }, new Environment(env)),
 			type: 'Block',
 		}
 	},
 	ForStatement: (ident, iterable, body) => {
+		// loops over `a..b` count from a to b instead of creating the range
+		const rangeLoop =
+			isBuiltinCall(iterable, 'range') && iterable.args.length === 3
+
 		env.define(ident.lexeme, null, true)
 		return {
 			ident,
 			iterable: analyze(iterable, compilingC),
 			body: analyze(body, compilingC),
+			binding: env.values[ident.lexeme],
+			rangeLoop,
 			type: 'ForStatement',
 		}
 	},
@@ -138,6 +191,9 @@ const analyzeVisitor = {
 		// TODO: handle other types like GetExpressions or IndexExpressions
 		if (target.type === 'VariableExpression') {
 			env.assign(target.ident.lexeme, null)
+
+			// assigned parameters get a copy of the argument (see the compiler)
+			if (compilingC) env.get(target.ident.lexeme).value.assigned = true
 		} else if (
 			target.type === 'GetExpression' ||
 			target.type === 'IndexExpression'
@@ -164,23 +220,12 @@ const analyzeVisitor = {
 			}
 		}
 
-		if (
-			compilingC &&
-			inFunction &&
-			!builtins.includes(target.ident.lexeme) &&
-			env.get(target.ident.lexeme) &&
-			currentDepth - env.get(target.ident.lexeme).steps <=
-				inFunction.depth
-		) {
-			// the first time this external variable is used is when assigning to it
-			if (!closureCaptures.has(target.ident.lexeme)) {
-				closureCaptures.add(target.ident.lexeme)
-			}
-
-			target.ident.lexeme = `environment[${[...closureCaptures].indexOf(
-				target.ident.lexeme
-			)}]`
-		}
+		/*
+			analyzing the target resolves captured variables, both when
+			assigning to them directly & when they're the root of a nested
+			get (the first time an external variable is used may be here).
+		*/
+		target = analyze(target, compilingC)
 
 		return {
 			target,
@@ -205,48 +250,69 @@ const analyzeVisitor = {
 	},
 	FunctionExpression: (parameters, body) => {
 		const func = {
+			name: `linx__anonymous_fn$${anonymousFnCount()}`,
 			closure: new Environment(env).clone(),
 			arity: () => parameters.length,
 			captures: [],
 			depth: currentDepth,
+			parent: inFunction,
 		}
 
 		parameters.forEach((param) => {
 			func.closure.define(param.lexeme, null, true)
 		})
+		func.parameterBindings = parameters.map(
+			(param) => func.closure.values[param.lexeme]
+		)
 
+		let prevFunction = inFunction
 		inFunction = func
 
-		let funcCaptures = new Set()
-		body.statements = analyzeBlock(body, func.closure, funcCaptures)
-		func.captures = Array.from(closureCaptures)
+		body.statements = analyzeBlock(body, func.closure)
 
-		inFunction = null
+		inFunction = prevFunction
 
 		return { parameters, body, func, type: 'FunctionExpression' }
 	},
 	VariableExpression: (ident) => {
-		if (
-			compilingC &&
-			inFunction &&
-			!builtins.includes(ident.lexeme) &&
-			env.get(ident.lexeme) &&
-			currentDepth - env.get(ident.lexeme).steps <= inFunction.depth
-		) {
-			if (!closureCaptures.has(ident.lexeme)) {
-				closureCaptures.add(ident.lexeme)
-			}
+		/*
+			functions are hoisted in JS, so names can be used before they're
+			declared. the binding is only noted for the optimizer where it's
+			already known, names that aren't are left alone.
+		*/
+		if (!compilingC) {
+			const binding = lookup(ident.lexeme)
+			const builtin =
+				binding && binding === builtinBindings[ident.lexeme]
+					? ident.lexeme
+					: undefined
 
-			ident.lexeme = `environment[${[...closureCaptures].indexOf(
-				ident.lexeme
-			)}]`
+			return { ident, binding, builtin, type: 'VariableExpression' }
 		}
 
-		// variable being referenced was either not in a function, or was local to the function
-		return {
-			ident,
-			type: 'VariableExpression',
+		const { value: binding, steps } = env.get(ident.lexeme)
+		let builtin, captured
+
+		if (binding === builtinBindings[ident.lexeme]) {
+			builtin = ident.lexeme
+
+			// builtins are static values created once by the runtime
+			ident.lexeme = `${ident.lexeme}__builtin`
+		} else {
+			// used by the compiler to find functions that are only ever called
+			binding.references = (binding.references || 0) + 1
+
+			/*
+				variables declared outside the current function are read from
+				its environment, the compiler decides where in it they're stored.
+			*/
+			if (inFunction && currentDepth - steps <= inFunction.depth) {
+				capture(inFunction, binding, ident.lexeme, currentDepth - steps)
+				captured = inFunction
+			}
 		}
+
+		return { ident, binding, builtin, captured, type: 'VariableExpression' }
 	},
 	GetExpression: (object, ident) => {
 		return {
@@ -264,8 +330,16 @@ const analyzeVisitor = {
 	},
 	CallExpression: (callee, args) => {
 		// console.log('callee: ', callee)
+		callee = analyze(callee, compilingC)
+
+		// calls the compiler can make directly (see `directCall`)
+		const func = callee.binding && callee.binding.func
+		if (func && func.parameterBindings.length === args.length) {
+			callee.binding.calls = (callee.binding.calls || 0) + 1
+		}
+
 		return {
-			callee: analyze(callee, compilingC),
+			callee,
 			args: args.map((arg) => analyze(arg, compilingC)),
 			type: 'CallExpression',
 		}
@@ -297,4 +371,14 @@ function analyze(node, compilingCArg) {
 	return walk(node, analyzeVisitor)
 }
 
-module.exports = { analyze }
+// analyzes a whole program (or module) in a fresh global scope
+function analyzeProgram(ast, compilingCArg) {
+	env = new Environment()
+	builtins.forEach((builtin) => {
+		env.values[builtin] = builtinBindings[builtin]
+	})
+
+	return analyze(ast, compilingCArg)
+}
+
+module.exports = { analyze, analyzeProgram }
@@ -0,0 +1,146 @@
+const { basename } = require('path')
+const { spawnSync } = require('child_process')
+
+const { programFiles, buildProgram } = require('./programs')
+
+/*
+	the C runtime prints a line of stats on exit when `LINX_STATS` is set,
+	the JS output gets a footer that prints the same line.
+*/
+const statsPrefix = 'linx-stats '
+
+const jsStatsFooter = `
+process.on('exit', () => {
+	console.error('${statsPrefix}' + JSON.stringify({
+		allocations: null,
+		peak_rss_kb: process.resourceUsage().maxRSS,
+	}))
+})`
+
+function run([command, args]) {
+	const start = process.hrtime.bigint()
+	const result = spawnSync(command, args, {
+		env: { ...process.env, LINX_STATS: '1' },
+		stdio: ['ignore', 'ignore', 'pipe'],
+		encoding: 'utf-8',
+		maxBuffer: 64 * 1024 * 1024,
+	})
+	const time = Number(process.hrtime.bigint() - start) / 1e6
+
+	if (result.status !== 0) {
+		process.stderr.write(result.stderr)
+		throw new Error(`'${command}' exited with status ${result.status}.`)
+	}
+
+	const line = result.stderr
+		.split('\n')
+		.find((line) => line.startsWith(statsPrefix))
+	return { time, ...(line ? JSON.parse(line.slice(statsPrefix.length)) : {}) }
+}
+
+function statistics(times) {
+	const sorted = [...times].sort((a, b) => a - b)
+	const mean = times.reduce((sum, time) => sum + time, 0) / times.length
+	const variance =
+		times.reduce((sum, time) => sum + (time - mean) ** 2, 0) / times.length
+	const middle = Math.floor(sorted.length / 2)
+
+	return {
+		mean,
+		median:
+			sorted.length % 2 === 0
+				? (sorted[middle - 1] + sorted[middle]) / 2
+				: sorted[middle],
+		min: sorted[0],
+		max: sorted[sorted.length - 1],
+		stddev: Math.sqrt(variance),
+	}
+}
+
+async function benchmark(file, backend, options) {
+	const command = await buildProgram(file, backend, {
+		prefix: 'bench',
+		cc: options.cc,
+		flags: [],
+		footer: jsStatsFooter,
+	})
+
+	for (let i = 0; i < options.warmup; i++) run(command)
+
+	let runs = []
+	for (let i = 0; i < options.runs; i++) runs.push(run(command))
+
+	const last = runs[runs.length - 1]
+	return {
+		name: basename(file, '.li'),
+		backend,
+		runs: options.runs,
+		time_ms: statistics(runs.map((run) => run.time)),
+		peak_rss_kb: Math.max(...runs.map((run) => run.peak_rss_kb || 0)),
+		// programs are deterministic, so these are the same for every run
+		allocations: last.allocations === undefined ? null : last.allocations,
+		collections: last.collections === undefined ? null : last.collections,
+	}
+}
+
+function formatRow(columns) {
+	return columns
+		.map((column, i) => (i < 2 ? column.padEnd(12) : column.padStart(12)))
+		.join('')
+}
+
+function printResults(results) {
+	console.log(
+		formatRow([
+			'benchmark',
+			'backend',
+			'mean ms',
+			'median ms',
+			'stddev ms',
+			'min ms',
+			'peak rss kB',
+			'allocations',
+		])
+	)
+
+	results.forEach((result) => {
+		const { mean, median, stddev, min } = result.time_ms
+		console.log(
+			formatRow([
+				result.name,
+				result.backend,
+				mean.toFixed(1),
+				median.toFixed(1),
+				stddev.toFixed(1),
+				min.toFixed(1),
+				String(result.peak_rss_kb),
+				result.allocations === null ? '-' : String(result.allocations),
+			])
+		)
+	})
+}
+
+/*
+	compiles every benchmark with the C backend (the same as `linx compile`
+	does) & runs it through the JS backend, timing `options.runs` runs of each after `options.warmup`
+	unmeasured ones.
+*/
+async function bench(paths, options) {
+	let results = []
+	for (const file of programFiles(paths, ['.li'])) {
+		for (const backend of options.backends) {
+			if (!options.json) console.error(`running ${file} (${backend})...`)
+			results.push(await benchmark(file, backend, options))
+		}
+	}
+
+	if (options.json) {
+		console.log(JSON.stringify({ date: new Date(), results }, null, 2))
+	} else {
+		printResults(results)
+	}
+
+	return results
+}
+
+module.exports = { bench }
@@ -0,0 +1,248 @@
+const { join, resolve } = require('path')
+const { spawn } = require('child_process')
+const {
+	readFileSync,
+	writeFileSync,
+	existsSync,
+	mkdirSync,
+	readdirSync,
+	renameSync,
+	rmSync,
+	unlinkSync,
+} = require('fs')
+
+const { Lexer } = require('./lexer')
+const { Parser } = require('./parser')
+const { bundleModule } = require('./bundler')
+const { compileModule } = require('./compiler')
+const { contentHash } = require('./util')
+
+/*
+	incremental builds for the C backend. every module of a program is
+	compiled to its own C unit & object file, which are cached in
+	`tmp/cache/` under a hash of everything that went into them:
+
+	- parsed ASTs are keyed by the source of the module & of the compiler,
+	  so a change to the lexer or parser doesn't reuse stale trees.
+	- generated C is keyed by the module's source & path, & the source of
+	  the compiler itself. modules call the modules they import through
+	  entry points named after their paths, so a unit doesn't change when
+	  the modules it imports do.
+	- object files are keyed by the C unit, the runtime & the flags they're
+	  compiled with.
+	- the runtime is compiled once (per set of flags) into `libLinxRuntime`,
+	  a static library every program links with.
+
+	a rebuild after editing one file only regenerates & recompiles that
+	file's unit, then links the program again.
+*/
+
+const cacheDir = join(__dirname, '../tmp/cache')
+const runtimeDir = join(__dirname, 'runtimes/c')
+
+const compilerHash = contentHash(
+	...readdirSync(__dirname)
+		.filter((file) => file.endsWith('.js'))
+		.sort()
+		.map((file) => readFileSync(join(__dirname, file), 'utf-8'))
+)
+
+function cached(name) {
+	return join(cacheDir, name)
+}
+
+// `undefined` fields are kept as `null`, walking an AST relies on their order
+function serialize(ast) {
+	return JSON.stringify(ast, (key, value) =>
+		value === undefined ? null : value
+	)
+}
+
+function parse(source) {
+	const path = cached(`${contentHash(compilerHash, source)}.ast.json`)
+	if (existsSync(path)) return JSON.parse(readFileSync(path, 'utf-8'))
+
+	let lexer = new Lexer(source)
+	let parser = new Parser(lexer.scanTokens())
+	const ast = parser.parse()
+
+	writeFileSync(path, serialize(ast))
+	return ast
+}
+
+/*
+	generates the C unit of the module at `path` (if it isn't cached yet),
+	returns its key & the paths of the modules it imports.
+*/
+function generate(path, entry) {
+	const source = readFileSync(path, 'utf-8')
+	const key = contentHash(compilerHash, path, entry, source)
+	const imports = cached(`${key}.imports.json`)
+
+	if (!existsSync(imports)) {
+		const module = bundleModule(parse(source), path)
+		writeFileSync(cached(`${key}.c`), compileModule(module.ast, path, entry))
+		writeFileSync(imports, JSON.stringify(module.imports))
+	}
+
+	return { key, imports: JSON.parse(readFileSync(imports, 'utf-8')) }
+}
+
+// the C units of the program at `path` & every module it imports
+function generateAll(path) {
+	let units = new Map()
+	let pending = [[path, true]]
+
+	while (pending.length > 0) {
+		const [modulePath, entry] = pending.shift()
+		if (units.has(modulePath)) continue
+
+		const unit = generate(modulePath, entry)
+		units.set(modulePath, unit)
+		unit.imports.forEach((imported) => pending.push([imported, false]))
+	}
+
+	return [...units.values()]
+}
+
+function run(command, args) {
+	return new Promise((resolve) => {
+		spawn(command, args, { stdio: 'inherit' }).on('close', resolve)
+	})
+}
+
+// optimization flags of each build mode, for compiling & linking
+const modes = {
+	// fat LTO objects keep the runtime library usable by any linker
+	release: {
+		compile: ['-O2', '-flto', '-ffat-lto-objects'],
+		link: ['-O2', '-flto'],
+	},
+	debug: { compile: ['-O0', '-g'], link: ['-g'] },
+}
+
+/*
+	profile guided builds compile everything twice: instrumented first to
+	record a profile of the program running, then optimized with it. the
+	compiler finds the profile of an object file by its path, so both
+	builds write their objects to the same (uncached) directory.
+*/
+const pgoStages = {
+	generate: ['-fprofile-generate'],
+	use: ['-fprofile-use', '-fprofile-correction', '-Wno-missing-profile'],
+}
+
+/*
+	compiles `source` to `object`. cached objects are only compiled if they
+	don't exist yet, & are written to a temporary file first so failed
+	compiles aren't cached.
+*/
+async function compileObject(source, object, flags, options, cache) {
+	if (cache && existsSync(object)) return object
+
+	const output = cache ? `${object}.tmp` : object
+	const code = await run(options.cc, [
+		source,
+		'-c',
+		'-o',
+		output,
+		`-I${runtimeDir}`,
+		...flags,
+	])
+	if (code !== 0) throw new Error(`Could not compile ${source}.`)
+
+	if (cache) renameSync(output, object)
+	return object
+}
+
+// `libLinxRuntime`, the runtime built as a static library
+async function runtimeLibrary(name, flags, options, cache) {
+	const library = `${name}.a`
+	if (cache && existsSync(library)) return library
+
+	const object = await compileObject(
+		join(runtimeDir, 'runtime.c'),
+		`${name}.o`,
+		flags,
+		options,
+		cache
+	)
+
+	if (existsSync(library)) unlinkSync(library)
+	if ((await run(process.env.AR || 'ar', ['rcs', library, object])) !== 0) {
+		throw new Error('Could not archive the runtime library.')
+	}
+
+	return library
+}
+
+// compiles the changed units of a program & links it with the runtime
+async function link(path, options, pgo) {
+	const mode = modes[options.mode]
+	const stage = pgo ? pgoStages[pgo.stage] : []
+	const flags = [...options.flags, '-pthread', ...mode.compile, ...stage]
+
+	const runtimeHash = contentHash(
+		...['runtime.h', 'runtime.c'].map((file) =>
+			readFileSync(join(runtimeDir, file), 'utf-8')
+		)
+	)
+	const flagsHash = contentHash(options.cc, ...flags)
+	// cached files are named after their key, profile guided builds' aren't
+	const output = (name, key) =>
+		pgo ? join(pgo.directory, name) : cached(`${name}-${key}`)
+
+	const [library, ...objects] = await Promise.all([
+		runtimeLibrary(
+			output('libLinxRuntime', contentHash(runtimeHash, flagsHash)),
+			flags,
+			options,
+			!pgo
+		),
+		...generateAll(resolve(path)).map(({ key }) =>
+			compileObject(
+				cached(`${key}.c`),
+				`${output(key, contentHash(runtimeHash, flagsHash))}.o`,
+				flags,
+				options,
+				!pgo
+			)
+		),
+	])
+
+	// the flags are passed on to the linker too, for sanitizers & the like
+	const code = await run(options.cc, [
+		...objects,
+		library,
+		'-pthread',
+		...options.flags,
+		...mode.link,
+		...stage,
+		'-o',
+		options.output,
+	])
+	if (code !== 0) throw new Error(`Could not link ${path}.`)
+}
+
+/*
+	builds the program at `path` to an executable, compiling only the
+	modules (& runtime) that changed since the last build. `options.mode`
+	is 'release' or 'debug', profile guided builds (`options.pgo`) run the
+	instrumented program once (without arguments) to train on.
+*/
+async function build(path, options) {
+	if (!existsSync(cacheDir)) mkdirSync(cacheDir, { recursive: true })
+	if (!options.pgo) return link(path, options, null)
+
+	const directory = cached(`pgo-${contentHash(resolve(path))}`)
+	rmSync(directory, { recursive: true, force: true })
+	mkdirSync(directory)
+
+	await link(path, options, { directory, stage: 'generate' })
+	if ((await run(resolve(options.output), [])) !== 0) {
+		throw new Error('The instrumented program exited with an error.')
+	}
+	await link(path, options, { directory, stage: 'use' })
+}
+
+module.exports = { build }
@@ -1,3 +1,31 @@
-const builtins = ['len', 'type', 'range', 'toString', 'keys', 'iterator']
+const builtins = [
+	'len',
+	'type',
+	'range',
+	'toString',
+	'keys',
+	'iterator',
+	'set',
+	'map',
+	'sort',
+	'sortBy',
+	'parallel',
+	'fs',
+	'lists',
+]
 
-module.exports = { builtins }
+// number of arguments each builtin function takes, the rest are objects
+const builtinArity = {
+	len: 1,
+	type: 1,
+	range: 3,
+	toString: 1,
+	keys: 1,
+	iterator: 1,
+	set: 1,
+	map: 1,
+	sort: 1,
+	sortBy: 2,
+}
+
+module.exports = { builtins, builtinArity }
@@ -1,203 +1,100 @@
-const { walk } = require('./walk')
 const { Lexer } = require('./lexer')
 const { Parser } = require('./parser')
 const { resolve, dirname } = require('path')
 const { readFileSync, existsSync } = require('fs')
 const { Token } = require('./token')
+const { childFields } = require('./walk')
 
 const cwd = process.cwd()
 
-/*
-    removes instances of `ImportExpression` & `ExportDeclaration`
-    nodes from an AST by performing file resolution & bundling.
+// the paths of the modules imported by the file being bundled, see `bundleModule`
+let importedModules = null
 
-    is shared by both the JS interpreter & the C compiled runtime.
-*/
-function bundle(ast, path = cwd) {
-	let linxExports = []
+// the imported module at `importPath`, as a call to a function of its body
+function importModule(importPath, path) {
+	const importedPath = resolve(dirname(path), importPath.lexeme.slice(1, -1))
 
-	ast = walk(ast, {
-		// decls
-		FunctionDeclaration(ident, parameters, body) {
-			return {
-				ident,
-				parameters,
-				body: bundle(body, path),
-				type: 'FunctionDeclaration',
-			}
-		},
-		VariableDeclaration: (ident, initializer) => {
-			return {
-				ident,
-				initializer: bundle(initializer, path),
-				type: 'VariableDeclaration',
-			}
-		},
-		ConstantDeclaration: (ident, initializer) => {
-			return {
-				ident,
-				initializer: bundle(initializer, path),
-				type: 'ConstantDeclaration',
-			}
-		},
+	if (!existsSync(importedPath)) {
+		throw new Error(`Imported file: '${importedPath}' does not exist.`)
+	}
 
-		// stmts
-		ExpressionStatement: (expression) => {
-			return {
-				expression: bundle(expression, path),
-				type: 'ExpressionStatement',
-			}
-		},
-		IfStatement: (condition, thenBlock, elseBlock) => {
-			return {
-				condition: bundle(condition, path),
-				thenBlock: bundle(thenBlock, path),
-				elseBlock: bundle(elseBlock, path),
-				type: 'IfStatement',
-			}
-		},
-		PrintStatement: (expression) => {
-			return {
-				expression: bundle(expression, path),
-				type: 'PrintStatement',
-			}
-		},
-		ReturnStatement: (expression) => {
-			return {
-				expression: bundle(expression, path),
-				type: 'ReturnStatement',
-			}
-		},
-		ForStatement: (ident, iterable, body) => {
-			return {
-				ident,
-				iterable: bundle(iterable, path),
-				body: bundle(body, path),
-				type: 'ForStatement',
-			}
-		},
-		WhileStatement: (condition, body) => {
-			return {
-				condition: bundle(condition, path),
-				body: bundle(body, path),
-				type: 'WhileStatement',
-			}
-		},
-		Block: (statements) => {
-			return {
-				statements: bundle(statements, path),
-				type: 'Block',
-			}
-		},
+	if (importedModules) {
+		importedModules.push(importedPath)
+		return { path: importedPath, type: 'ModuleExpression' }
+	}
 
-		// exprs
-		AssignmentExpression: (expr, value) => {
-			return {
-				target: bundle(expr, path),
-				value: bundle(value, path),
-				type: 'AssignmentExpression',
-			}
-		},
-		BinaryExpression: (left, operator, right) => {
-			return {
-				left: bundle(left, path),
-				operator,
-				right: bundle(right, path),
-				type: 'BinaryExpression',
-			}
-		},
-		UnaryExpression: (operator, expression) => {
-			return {
-				operator,
-				expression: bundle(expression, path),
-				type: 'UnaryExpression',
-			}
-		},
-		GetExpression: (object, ident) => {
-			return {
-				object: bundle(object, path),
-				ident,
-				type: 'GetExpression',
-			}
-		},
-		IndexExpression: (array, index) => {
-			return {
-				array: bundle(array, path),
-				index,
-				type: 'IndexExpression',
-			}
-		},
-		CallExpression: (callee, args) => {
-			return {
-				callee: bundle(callee, path),
-				args: args.map(bundle),
-				type: 'CallExpression',
-			}
-		},
-		FunctionExpression: (parameters, body) => {
-			return {
-				parameters,
-				body: bundle(body, path),
+	const contents = readFileSync(importedPath, 'utf-8')
+
+	let l = new Lexer(contents)
+	let p = new Parser(l.scanTokens())
+
+	return {
+		callee: {
+			expression: {
+				parameters: [],
+				body: {
+					statements: bundle(p.parse(), importedPath),
+					type: 'Block',
+				},
 				type: 'FunctionExpression',
-			}
-		},
-		GroupExpression: (expression) => {
-			return {
-				expression: bundle(expression, path),
-				type: 'GroupExpression',
-			}
+			},
+			type: 'GroupExpression',
 		},
+		args: [],
+		type: 'CallExpression',
+	}
+}
 
-		// literals
-		ArrayLiteral: (values) => {
-			return { values: values.map(bundle), type: 'ArrayLiteral' }
-		},
-		ObjectLiteral: (pairs) => {
-			return {
-				pairs: pairs.map((pair) => [pair[0], bundle(pair[1])], path),
-				type: 'ObjectLiteral',
-			}
-		},
+/*
+	bundles `node` in place: only the nodes that are replaced (imports &
+	exports) are created, every other node is kept & just has its children
+	bundled. returns the bundled node.
+*/
+function bundleNode(node, path, linxExports) {
+	if (Array.isArray(node)) {
+		for (let i = 0; i < node.length; i++) {
+			node[i] = bundleNode(node[i], path, linxExports)
+		}
+		return node
+	}
 
+	if (!node) return node
+
+	switch (node.type) {
 		// module system
-		ExportDeclaration(declaration) {
-			linxExports.push(declaration.ident.lexeme)
-			return bundle(declaration, path)
-		},
-		ImportExpression(importPath) {
-			const importedPath = resolve(
-				dirname(path),
-				importPath.lexeme.slice(1, -1)
-			)
-
-			if (!existsSync(importedPath)) {
-				throw new Error(
-					`Imported file: '${importedPath}' does not exist.`
-				)
-			}
-
-			const contents = readFileSync(importedPath, 'utf-8')
-
-			let l = new Lexer(contents)
-			let p = new Parser(l.scanTokens())
-
-			return {
-				callee: {
-					expression: {
-						parameters: [],
-						body: {
-							statements: bundle(p.parse(), importedPath),
-							type: 'Block',
-						},
-						type: 'FunctionExpression',
-					},
-					type: 'GroupExpression',
-				},
-				args: [],
-				type: 'CallExpression',
-			}
-		},
-	})
+		case 'ExportDeclaration':
+			linxExports.push(node.declaration.ident.lexeme)
+			return bundleNode(node.declaration, path, linxExports)
+		case 'ImportExpression':
+			return importModule(node.path, path)
+
+		case 'ObjectLiteral':
+			node.pairs.forEach((pair) => {
+				pair[1] = bundleNode(pair[1], path, linxExports)
+			})
+			return node
+	}
+
+	const fields = childFields[node.type]
+	if (fields) {
+		for (const field of fields) {
+			node[field] = bundleNode(node[field], path, linxExports)
+		}
+	}
+
+	return node
+}
+
+/*
+    removes instances of `ImportExpression` & `ExportDeclaration`
+    nodes from an AST by performing file resolution & bundling.
+
+    is shared by both the JS interpreter & the C compiled runtime.
+*/
+function bundle(ast, path = cwd) {
+	let linxExports = []
+
+	ast = bundleNode(ast, path, linxExports)
 
 	if (linxExports.length > 0 && Array.isArray(ast)) {
 		ast.push({
@@ -218,4 +115,18 @@ function bundle(ast, path = cwd) {
 	return ast
 }
 
-module.exports = { bundle }
+/*
+	bundles a single module for separate compilation: imports are left as
+	`ModuleExpression` nodes referring to the imported file instead of being
+	inlined. returns the AST with the paths of the modules it imports.
+*/
+function bundleModule(ast, path) {
+	importedModules = []
+	ast = bundle(ast, path)
+
+	const imports = importedModules
+	importedModules = null
+	return { ast, imports }
+}
+
+module.exports = { bundle, bundleModule }
@@ -1,21 +1,51 @@
 const { walk } = require('./walk')
 const { Lexer } = require('./lexer')
 const { Parser } = require('./parser')
-const { analyze } = require('./analyzer')
-const { builtins } = require('./builtins')
+const { analyzeProgram } = require('./analyzer')
+const { optimize } = require('./optimizer')
+const { inferTypes } = require('./inference')
+const { builtinArity } = require('./builtins')
 const { bundle } = require('./bundler')
-const { createCounter } = require('./util')
+const { createCounter, contentHash } = require('./util')
 
-function anonymousFnId() {
-	let count = -1
-	return () => {
-		count++
-		return `linx__anonymous_fn$${count}`
+const inlineCacheCount = createCounter(0)
+const iteratorCount = createCounter(0)
+
+// every property read site gets its own statically allocated inline cache
+let inlineCaches = []
+
+/*
+	string literals & property names are interned once at startup, the
+	generated code then refers to them through static symbol values.
+*/
+let symbols = new Map()
+
+function symbol(string) {
+	const escaped = string.split('\n').join('\\n')
+
+	if (!symbols.has(escaped)) {
+		symbols.set(escaped, `linx__symbol${symbols.size}`)
 	}
+
+	return symbols.get(escaped)
 }
 
-const getFnId = anonymousFnId()
-const funcMangleCount = createCounter(0)
+/*
+	number literals are compiled to static values, so evaluating one doesn't
+	allocate. nothing writes to the value of a literal (variables get a copy
+	of their own), so every use of the same number shares one value.
+*/
+let constants = new Map()
+
+function constant(value) {
+	const literal = numberLiteral(value)
+
+	if (!constants.has(literal)) {
+		constants.set(literal, `linx__constant${constants.size}`)
+	}
+
+	return `(&${constants.get(literal)})`
+}
 
 function binaryOp(left, operator, right) {
 	const operatorFunctionMap = {
@@ -50,93 +80,462 @@ function unaryOp(operator, expr) {
 // list of function declarations in order. can be codegenned in reverse to lift closures
 let fnDecls = []
 
-function varOrConstDeclaration(ident, initializer) {
-	return `Value* ${ident.lexeme} = Value__create_nil(); Value__copy(${
-		ident.lexeme
-	}, ${codegen(initializer)});`
+/*
+	functions only get a generic entry point when they're used as values,
+	everything else calls them directly.
+*/
+let definitions = new Set()
+
+// the entry points of the separately compiled modules this unit imports
+let importedModules = new Set()
+
+function moduleName(path) {
+	return `linx__module_${contentHash(path).slice(0, 16)}`
+}
+
+/*
+	closures & their environments. constants (& functions that are never
+	reassigned) are copied into the closures that capture them, everything
+	else is captured by reference.
+*/
+function capturedByValue(binding) {
+	return !binding.mutable || (binding.func && !binding.assigned)
+}
+
+/*
+	functions that are only ever called directly (never used as a value,
+	see `directCall`) can't outlive the scope they're declared in, so their
+	environment is a plain array on the stack instead of a closure.
+*/
+function isLocal(func) {
+	const onlyCalled = (binding) =>
+		!binding.assigned &&
+		!binding.captured &&
+		(binding.references || 0) === (binding.calls || 0)
+
+	return (
+		func.binding &&
+		onlyCalled(func.binding) &&
+		(!func.self || onlyCalled(func.self))
+	)
+}
+
+// captures in environment order, the ones copied into the closure go last
+function environmentOf(func) {
+	if (!func.environment) {
+		func.environment = [
+			...func.captures.filter(({ binding }) => !capturedByValue(binding)),
+			...func.captures.filter(({ binding }) => capturedByValue(binding)),
+		]
+	}
+
+	return func.environment
+}
+
+function environmentIndex(func, binding) {
+	return environmentOf(func).findIndex(
+		(captured) => captured.binding === binding
+	)
+}
+
+// the captured variables of `func`, as seen from where it's created
+function captureValues(func) {
+	return environmentOf(func).map(({ binding, name }) =>
+		func.parent && environmentIndex(func.parent, binding) !== -1
+			? `environment[${environmentIndex(func.parent, binding)}]`
+			: name
+	)
+}
+
+// `captures` is the environment to copy, defaults to the captured variables
+function createClosure(func, captures) {
+	const environment = environmentOf(func)
+	const values = environment.filter(({ binding }) =>
+		capturedByValue(binding)
+	)
+
+	if (!captures) {
+		captures =
+			environment.length > 0
+				? `(Value*[]){${captureValues(func).join(', ')}}`
+				: 'NULL'
+	}
+
+	definitions.add(func)
+	return `Value__create_fn(&${func.name}__linx_definition, ${captures}, ${
+		environment.length
+	}, ${values.length})`
+}
+
+function localEnvironment(func) {
+	return func.captures.length > 0
+		? `Value* ${func.name}__environment[] = {${captureValues(func).join(
+				', '
+		  )}};`
+		: ''
+}
+
+/*
+	values are allocated in the runtime's nursery & only survive as long as
+	the stack refers to them. variables captured by reference by a closure
+	that can outlive the call declaring them get their own cell on the heap.
+*/
+function needsCell(binding) {
+	return (
+		binding &&
+		binding.captured &&
+		!capturedByValue(binding) &&
+		binding.capturedBy.some((func) => !isLocal(func))
+	)
+}
+
+/*
+	captured variables & cells outlive the call, returning one would hand
+	the caller the variable itself. constants copied into a closure are
+	also in the middle of its allocation, which tgc doesn't see as a
+	reference to it (it only recognises pointers to where one starts), so
+	the closure could be collected while the value is still in use.
+*/
+function escapes(node) {
+	return (
+		node &&
+		node.type === 'VariableExpression' &&
+		!unboxed(node) &&
+		(node.captured || needsCell(node.binding))
+	)
+}
+
+function cell(binding, value) {
+	return needsCell(binding) ? `Value__create_cell(${value})` : value
+}
+
+function varOrConstDeclaration(ident, initializer, binding) {
+	if (binding && binding.unboxed === 'number') {
+		return `double ${ident.lexeme} = ${num(initializer)};`
+	} else if (binding && binding.unboxed === 'bool') {
+		return `bool ${ident.lexeme} = ${cond(initializer)};`
+	}
+
+	// functions that are only called directly don't need a closure
+	if (
+		initializer &&
+		initializer.type === 'FunctionExpression' &&
+		isLocal(initializer.func)
+	) {
+		const { parameters, body, func } = initializer
+		fnDecls.push({ parameters, body, func })
+		return localEnvironment(func)
+	}
+
+	if (needsCell(binding)) {
+		return `Value* ${ident.lexeme} = ${cell(binding, codegen(initializer))};`
+	}
+
+	return `Value* ${ident.lexeme} = Value__from_value(${codegen(initializer)});`
+}
+
+/*
+	codegen for the containers along an assignment target (the `a.b` in
+	`a.b[0] = x`). lists & objects are copy-on-write, so these go through
+	the `_mut` operators which unshare each container before writing.
+*/
+function lvalue(node) {
+	switch (node.type) {
+		case 'GetExpression':
+			return `linx__operator_dot_mut(${lvalue(node.object)}, ${symbol(
+				node.ident.lexeme
+			)})`
+		case 'IndexExpression':
+			return `linx__operator_subscript_mut(${lvalue(
+				node.array
+			)}, ${codegen(node.index)})`
+		default:
+			return codegen(node)
+	}
+}
+
+/*
+	`lists.push` & `lists.pop` change the list they're given. a list inside
+	another one or an object (`lists.push(a.items, x)`) is passed the way
+	an assignment target is, so the change is made to its container's own
+	copy instead of a copy of the list.
+*/
+function changesList(callee) {
+	return (
+		callee.type === 'GetExpression' &&
+		callee.object.type === 'VariableExpression' &&
+		callee.object.builtin === 'lists' &&
+		['push', 'pop'].includes(callee.ident.lexeme)
+	)
+}
+
+function callArguments(callee, args) {
+	if (!changesList(callee) || args.length === 0) return codegen(args)
+	return [lvalue(args[0]), ...codegen(args.slice(1))]
+}
+
+/*
+	type specialized codegen. expressions the inference pass proved to be
+	numbers or booleans are computed with plain C doubles & bools, they're
+	only boxed into a `Value` where a generic operator or function needs one.
+*/
+const comparisons = ['==', '!=', '<', '>', '<=', '>=']
+
+// whether the variable read (or assigned) by `node` is an unboxed local
+function unboxed(node) {
+	if (node.type === 'AssignmentExpression') node = node.target
+	return node.type === 'VariableExpression' && node.binding
+		? node.binding.unboxed
+		: undefined
+}
+
+// unboxed variables always hold their type, even where inference lost track
+function typeOf(node) {
+	return unboxed(node) || node.inferred
+}
+
+function operandsType(left, right) {
+	return typeOf(left) === typeOf(right) ? typeOf(left) : null
+}
+
+// whether `node` is worth computing unboxed (& boxing the result after)
+function specialized(node) {
+	if (unboxed(node)) return true
+
+	switch (node.type) {
+		case 'UnaryExpression':
+			return true
+		case 'BinaryExpression': {
+			const op = node.operator.lexeme
+			if (typeOf(node) === 'number') return true
+
+			return (
+				!comparisons.includes(op) ||
+				op === '==' ||
+				op === '!=' ||
+				['number', 'bool'].includes(operandsType(node.left, node.right))
+			)
+		}
+		default:
+			return false
+	}
+}
+
+// number literals have to be doubles in C, `1 / 2` would be 0 otherwise
+function numberLiteral(value) {
+	const literal = String(value)
+	return /^[0-9]+$/.test(literal) ? `${literal}.0` : literal
+}
+
+// a C `double` expression for a node inferred to be a number
+function num(node) {
+	switch (node.type) {
+		case 'Literal':
+			return numberLiteral(node.value)
+		case 'VariableExpression':
+			// boxed variables might be captured, codegen finds them
+			if (unboxed(node)) return node.ident.lexeme
+			break
+		case 'AssignmentExpression':
+			if (!unboxed(node)) break
+			return `(${node.target.ident.lexeme} = ${num(node.value)})`
+		case 'BinaryExpression':
+			return `(${num(node.left)} ${node.operator.lexeme} ${num(
+				node.right
+			)})`
+		case 'UnaryExpression':
+			return `(-${num(node.expression)})`
+		case 'GroupExpression':
+			return `(${num(node.expression)})`
+	}
+
+	return `${codegen(node)}->as.number`
+}
+
+// a C `bool` expression for the truthiness of any node
+function cond(node) {
+	if (typeOf(node) === 'number') return `(${num(node)} != 0)`
+	if (typeOf(node) !== 'bool') return `Value__to_bool(${codegen(node)})`
+
+	switch (node.type) {
+		case 'Literal':
+			return node.value ? 'true' : 'false'
+		case 'VariableExpression':
+			// boxed variables might be captured, codegen finds them
+			if (unboxed(node)) return node.ident.lexeme
+			break
+		case 'AssignmentExpression':
+			if (!unboxed(node)) break
+			return `(${node.target.ident.lexeme} = ${cond(node.value)})`
+		case 'UnaryExpression':
+			return `(!${cond(node.expression)})`
+		case 'GroupExpression':
+			return `(${cond(node.expression)})`
+		case 'BinaryExpression': {
+			const { left, operator, right } = node
+			const op = operator.lexeme
+
+			// both operands are always evaluated, like with the runtime's `and` & `or`
+			if (op === 'and') return `(${cond(left)} & ${cond(right)})`
+			if (op === 'or') return `(${cond(left)} | ${cond(right)})`
+
+			switch (operandsType(left, right)) {
+				case 'number':
+					return `(${num(left)} ${op} ${num(right)})`
+				case 'bool':
+					return `(${cond(left)} ${op} ${cond(right)})`
+			}
+
+			if (op === '==' || op === '!=') {
+				return `${op === '!=' ? '!' : ''}Value__equals(${codegen(
+					left
+				)}, ${codegen(right)})`
+			}
+		}
+	}
+
+	return `${codegen(node)}->as.boolean`
+}
+
+// the function being compiled (see `compile`)
+let currentFn = null
+
+/*
+	calls to functions that are known at compile time skip the generic
+	`linx__operator_call` & go straight to the function's direct entry
+	point, which takes its parameters as separate arguments.
+*/
+function directCall(callee, args) {
+	if (callee.type !== 'VariableExpression' || !callee.binding) return null
+
+	if (callee.builtin) {
+		if (builtinArity[callee.builtin] !== args.length) return null
+		return `${callee.builtin}__builtin_def(NULL, (Value*[]){${codegen(
+			args
+		).join(', ')}})`
+	}
+
+	const { binding } = callee
+	const func = binding.func
+	if (
+		!func ||
+		binding.assigned ||
+		func.parameterBindings.length !== args.length
+	) {
+		return null
+	}
+
+	// a recursive call can reuse the caller's own environment
+	let environment = 'NULL'
+	if (currentFn && binding === currentFn.func.self) {
+		environment = 'environment'
+	} else if (func.captures.length > 0) {
+		environment = isLocal(func)
+			? `${func.name}__environment`
+			: `((Function*)${codegen(callee)}->as.raw)->environment`
+	}
+
+	return `${func.name}__linx_direct(${[environment, ...codegen(args)].join(
+		', '
+	)})`
+}
+
+function directSignature(fn) {
+	return `Value* ${fn.func.name}__linx_direct(${[
+		'Value** environment',
+		...fn.parameters.map((param, i) => `Value* linx__argument${i}`),
+	].join(', ')})`
+}
+
+/*
+	parameters refer to the caller's argument directly, one that's assigned
+	to gets a copy of its own so that the caller's variable isn't changed.
+*/
+function parameter(binding, argument) {
+	if (needsCell(binding)) return `Value__create_cell(${argument})`
+	if (binding.assigned) return `Value__from_value(${argument})`
+	return argument
 }
 
 const codegenVisitor = {
 	// decls
-	FunctionDeclaration: (ident, parameters, body, func) => {
-		let mangleSignature = funcMangleCount()
-
-		fnDecls.push({
-			name: ident.lexeme + mangleSignature,
-			parameters,
-			body,
-			captures: func.captures,
-		})
-
-		console.log(
-			'function',
-			ident.lexeme,
-			'is capturing',
-			func.captures.length,
-			'variaables'
-		)
-		return `Value* ${ident.lexeme} = Value__create_fn(&${
-			ident.lexeme
-		}${mangleSignature}__linx_definition, ${
-			func.captures.length > 0
-				? `(Value*[]){${func.captures.join(', ')}}`
-				: 'NULL'
-		}, ${func.captures.length});`
+	FunctionDeclaration: (ident, parameters, body, func, binding) => {
+		fnDecls.push({ ident: ident.lexeme, parameters, body, func })
+
+		if (isLocal(func)) return localEnvironment(func)
+
+		return `Value* ${ident.lexeme} = ${cell(binding, createClosure(func))};`
 	},
-	VariableDeclaration: (ident, initializer) =>
-		varOrConstDeclaration(ident, initializer),
-	ConstantDeclaration: (ident, initializer) =>
-		varOrConstDeclaration(ident, initializer),
+	VariableDeclaration: (ident, initializer, binding) =>
+		varOrConstDeclaration(ident, initializer, binding),
+	ConstantDeclaration: (ident, initializer, binding) =>
+		varOrConstDeclaration(ident, initializer, binding),
 
 	// stmts
 	ExpressionStatement: (expression) => {
+		// assignments to unboxed variables don't need their result boxed
+		if (unboxed(expression) === 'number') return num(expression) + ';'
+		if (unboxed(expression) === 'bool') return cond(expression) + ';'
+
 		return codegen(expression) + ';'
 	},
 	IfStatement: (condition, thenBlock, elseBlock) => {
-		return `if (Value__to_bool(${codegen(condition)})) ${codegen(
-			thenBlock
-		)} ${elseBlock ? `else ${codegen(elseBlock)}` : ''}`
+		return `if (${cond(condition)}) ${codegen(thenBlock)} ${
+			elseBlock ? `else ${codegen(elseBlock)}` : ''
+		}`
 	},
 	PrintStatement: (expression) => {
 		return `print(${codegen(expression)});`
 	},
 	ReturnStatement: (expression) => {
+		if (escapes(expression)) {
+			return `return Value__from_value(${codegen(expression)});`
+		}
+
 		return `return ${codegen(expression)};`
 	},
-	ForStatement: (ident, iterable, body) => {
-		let iteratorSignature = Date.now()
-		return `Value* iterator__${iteratorSignature} = linx__operator_call(iterator, (Value*[]){${codegen(
-			iterable
-		)}});
-				while (Value__to_bool(linx__operator_call(linx__operator_dot(iterator__${iteratorSignature}, Value__from_charptr("valid")), NULL))) {
-					Value* ${
-						ident.lexeme
-					} = linx__operator_call(linx__operator_dot(iterator__${iteratorSignature}, Value__from_charptr("next")), NULL);
+	ForStatement: (ident, iterable, body, binding, rangeLoop) => {
+		const iterator = `linx__iterator${iteratorCount()}`
+		const init = rangeLoop
+			? `Iterator__range(${codegen(iterable.args).join(', ')})`
+			: `Iterator__create(${codegen(iterable)})`
+
+		// an unboxed counter, the loop is then plain C arithmetic
+		if (rangeLoop && binding.unboxed === 'number') {
+			return `for (Iterator ${iterator} = ${init}; ${iterator}.index < ${iterator}.length; ${iterator}.index++) {
+					double ${ident.lexeme} = ${iterator}.start + ${iterator}.index * ${iterator}.step;
+					${codegen(body).slice(1, -1)}
+				}`
+		}
+
+		return `for (Iterator ${iterator} = ${init}; Iterator__valid(&${iterator});) {
+					Value* ${ident.lexeme} = ${cell(
+			binding,
+			`Iterator__next(&${iterator})`
+		)};
 					${codegen(body).slice(1, -1)}
 				}`
 	},
 	WhileStatement: (condition, body) => {
-		return `while (Value__to_bool(${codegen(condition)})) ${codegen(body)}`
+		return `while (${cond(condition)}) ${codegen(body)}`
 	},
 	Block: (statements) => {
 		return `{${statements.map((stmt) => codegen(stmt)).join('\n')}}`
 	},
 
 	// exprs
-	AssignmentExpression: (expr, value) => {
-		let gennedExpr = codegen(expr)
-
-		if (
-			gennedExpr.startsWith('linx__operator_dot') ||
-			gennedExpr.startsWith('linx__operator_subscript')
-		) {
-			let variableSignature = Date.now()
-			return `Value* $temp__${variableSignature} = ${gennedExpr};\nValue__copy($temp__${variableSignature}, ${codegen(
-				value
-			)})`
+	AssignmentExpression: (target, value) => {
+		if (target.type === 'GetExpression') {
+			return `linx__operator_dot_assign(${lvalue(target.object)}, ${symbol(
+				target.ident.lexeme
+			)}, ${codegen(value)})`
+		} else if (target.type === 'IndexExpression') {
+			return `linx__operator_subscript_assign(${lvalue(
+				target.array
+			)}, ${codegen(target.index)}, ${codegen(value)})`
 		}
 
-		return `Value__copy(${gennedExpr}, ${codegen(value)})`
+		return `linx__operator_assign(${codegen(target)}, ${codegen(value)})`
 	},
 	BinaryExpression: (left, operator, right) => {
 		return binaryOp(left, operator, right)
@@ -148,34 +547,50 @@ const codegenVisitor = {
 		return `linx__operator_subscript(${codegen(array)}, ${codegen(index)})`
 	},
 	GetExpression: (object, ident) => {
-		return `linx__operator_dot(${codegen(object)}, Value__from_charptr("${
+		const cache = `linx__inline_cache${inlineCacheCount()}`
+		inlineCaches.push(cache)
+
+		return `linx__operator_dot_cached(${codegen(object)}, ${symbol(
 			ident.lexeme
-		}"))`
+		)}, &${cache})`
 	},
 	CallExpression: (callee, args) => {
+		const direct = directCall(callee, args)
+		if (direct) return direct
+
 		return `linx__operator_call(${codegen(callee)}, ${
-			args.length > 0 ? `(Value*[]){${codegen(args).join(', ')}}` : 'NULL'
+			args.length > 0
+				? `(Value*[]){${callArguments(callee, args).join(', ')}}`
+				: 'NULL'
 		})`
 	},
 	FunctionExpression: (parameters, body, func) => {
-		const name = getFnId()
-
-		fnDecls.push({ name, parameters, body, captures: func.captures })
-		return `Value__create_fn(&${name}__linx_definition, ${
-			func.captures.length > 0
-				? `(Value*[]){${func.captures.join(', ')}}`
-				: 'NULL'
-		}, ${func.captures.length})`
+		fnDecls.push({ parameters, body, func })
+		return createClosure(func)
 	},
-	VariableExpression: (ident) => {
+	VariableExpression: (ident, binding, builtin, captured) => {
+		// the function refers to itself as a value, it needs its own closure
+		if (currentFn && binding && binding === currentFn.func.self) {
+			currentFn.selfUsed = true
+		}
+
+		if (captured) return `environment[${environmentIndex(captured, binding)}]`
 		return ident.lexeme
 	},
 	GroupExpression: (expression) => {
 		return `(${codegen(expression)})`
 	},
+	ModuleExpression: (path) => {
+		const name = moduleName(path)
+		importedModules.add(name)
+		return `${name}__linx_definition(NULL, NULL)`
+	},
 
 	// literals
 	ArrayLiteral: (values) => {
+		// C has no empty arrays
+		if (values.length === 0) return 'Value__create_list()'
+
 		return `Value__from_array((Value*[]){${values
 			.map(codegen)
 			.join(', ')}}, ${values.length})`
@@ -183,7 +598,10 @@ const codegenVisitor = {
 	ObjectLiteral: (pairs) => {
 		if (pairs.length > 0) {
 			return `Value__create_object_from_arrs((Value*[]){${pairs
-				.map((p) => `Value__from_charptr("${p[0].lexeme}")`)
+				.map((p) =>
+					// string keys (`{"a": 1}`) carry their unquoted value as the literal
+					symbol(p[0].literal != null ? p[0].literal : p[0].lexeme)
+				)
 				.join(', ')}}, (Value*[]){${pairs
 				.map((p) => codegen(p[1]))
 				.join(', ')}}, ${pairs.length})`
@@ -191,18 +609,18 @@ const codegenVisitor = {
 	},
 	Literal: (value) => {
 		if (typeof value === 'string') {
-			return `Value__from_charptr("${value.split('\n').join('\\n')}")`
+			return symbol(value)
 		} else if (typeof value === 'number') {
-			return `Value__from_double(${value})`
+			return constant(value)
 		}
 
 		switch (value) {
 			case true:
-				return 'Value__from_bool(true)'
+				return '(&linx_true)'
 			case false:
-				return 'Value__from_bool(false)'
+				return '(&linx_false)'
 			case null:
-				return 'Value__create_nil()'
+				return '(&linx_nil)'
 			default: {
 				console.error(`[Compiler Error] Unknown literal type: ${value}`)
 				process.exit(1)
@@ -212,70 +630,207 @@ const codegenVisitor = {
 }
 
 function codegen(node) {
+	if (Array.isArray(node)) return node.map(codegen)
+
+	if (node && specialized(node)) {
+		if (typeOf(node) === 'number') return `Value__from_double(${num(node)})`
+		if (typeOf(node) === 'bool') return `Value__from_bool(${cond(node)})`
+	}
+
 	return walk(node, codegenVisitor)
 }
 
-function compile(source, path) {
-	let lexer = new Lexer(source)
-	const tokens = lexer.scanTokens()
+function definitionSignature(func) {
+	return `Value* ${func.name}__linx_definition(Value** environment, Value** arguments)`
+}
 
-	let parser = new Parser(tokens)
-	let ast = parser.parse()
-	ast = bundle(ast, path)
-	ast = analyze(ast, true)
+// the generic entry point, used when the function is called as a value
+function definition(func, prologue = '') {
+	return `${definitionSignature(func)} {
+		${prologue}
+		return ${func.name}__linx_direct(${[
+		'environment',
+		...func.parameterBindings.map((binding, i) => `arguments[${i}]`),
+	].join(', ')});
+	}\n`
+}
 
-	const compiledStatements = codegen(ast)
+// generates every function the unit's code refers to
+function compileFunctions() {
 	let compiledFunctions = ''
+	let prototypes = ''
 
 	while (fnDecls.length !== 0) {
-		console.log(fnDecls)
-
-		fnDecls.forEach((fn) => {
-			let fnDef = `Value* ${
-				fn.name
-			}__linx_definition(Value** environment, Value** arguments) {
-				${builtins
-					.map(
-						(fn) =>
-							`Value* ${fn} = Value__create_fn(&${fn}__builtin_def, NULL, 0);`
-					)
-					.join('\n')}
-					
-					Value* ${fn.name} = Value__create_fn(&${
-				fn.name
-			}__linx_definition, environment, ${fn.captures.length});
-					${fn.parameters
-						.map(
-							(param, i) =>
-								`Value* ${param.lexeme} = arguments[${i}];`
-						)
-						.join('\n')} ${fn.body.statements
-				.map(codegen)
-				.join('\n')}}`
-
-			compiledFunctions = fnDef + compiledFunctions + '\n'
-
-			fnDecls = fnDecls.slice(1)
-		})
+		const fn = fnDecls.shift()
+		const { func } = fn
+
+		currentFn = { func, selfUsed: false }
+		const parameters = fn.parameters
+			.map(
+				(param, i) =>
+					`Value* ${param.lexeme} = ${parameter(
+						func.parameterBindings[i],
+						`linx__argument${i}`
+					)};`
+			)
+			.join('\n')
+		const body = fn.body.statements.map(codegen).join('\n')
+
+		// recursive functions refer to themselves through a closure of their own
+		const self =
+			func.self && (currentFn.selfUsed || func.self.captured)
+				? `Value* ${fn.ident} = ${cell(
+						func.self,
+						createClosure(func, 'environment')
+				  )};`
+				: ''
+		currentFn = null
+
+		prototypes += `static ${directSignature(fn)};\n`
+		compiledFunctions += `static ${directSignature(fn)} {
+				${self}
+				${parameters}
+				${body}
+			}\n`
 	}
 
-	return `
-#include "../src/runtimes/c/runtime.h"
+	definitions.forEach((func) => {
+		prototypes += `static ${definitionSignature(func)};\n`
+		compiledFunctions += `static ${definition(func)}`
+	})
 
-${compiledFunctions}
+	importedModules.forEach((name) => {
+		prototypes += `Value* ${name}__linx_definition(Value** environment, Value** arguments);\n`
+	})
 
-int main(int argc, char **argv) {
-	tgc_start(&gc, &argc);
-	${builtins
-		.map(
-			(fn) =>
-				`Value* ${fn} = Value__create_fn(&${fn}__builtin_def, NULL, 0);`
-		)
+	return `${prototypes}\n${compiledFunctions}`
+}
+
+function declarations() {
+	return `${inlineCaches
+		.map((cache) => `static InlineCache ${cache};`)
 		.join('\n')}
+${[...symbols.values()].map((name) => `static Value* ${name};`).join('\n')}
+${[...constants]
+	.map(
+		([literal, name]) =>
+			`static Value ${name} = {.type = TYPE_NUMBER, .as.number = ${literal}};`
+	)
+	.join('\n')}`
+}
+
+function internSymbols() {
+	return [...symbols]
+		.map(([string, name]) => `${name} = Value__intern("${string}");`)
+		.join('\n')
+}
+
+function reset() {
+	inlineCaches = []
+	symbols = new Map()
+	constants = new Map()
+	fnDecls = []
+	definitions = new Set()
+	importedModules = new Set()
+}
+
+// a whole program, `runtime` is the code that includes the C runtime
+function compileProgram(ast, runtime) {
+	ast = analyzeProgram(ast, true)
+	ast = optimize(ast)
+	ast = inferTypes(ast)
+
+	const compiledStatements = codegen(ast)
+	const functions = compileFunctions()
+
+	return `
+${runtime}
+
+${declarations()}
+
+${functions}
+
+static void linx__program() {
     ${compiledStatements.join('\n')}
-	tgc_stop(&gc);
+}
+
+int main(int argc, char **argv) {
+	linx_runtime_start(&argc);
+	${internSymbols()}
+	linx_runtime_run(&linx__program);
+	linx_runtime_stop();
 	return 0;
 }`
 }
 
-module.exports = { compile }
+/*
+	compiles a program & everything it imports to a single self contained
+	C file.
+*/
+function compile(source, path) {
+	reset()
+
+	let lexer = new Lexer(source)
+	const tokens = lexer.scanTokens()
+
+	let parser = new Parser(tokens)
+	let ast = parser.parse()
+	ast = bundle(ast, path)
+
+	// the whole runtime is included, so the output can be compiled on its own
+	return compileProgram(ast, '#include "../src/runtimes/c/runtime.c"')
+}
+
+/*
+	compiles a single module of a program (bundled with \`bundleModule\`) to
+	its own C unit, to be linked with the units of the modules it imports &
+	the runtime. the program's entry file gets \`main\`, other modules get
+	an entry point named after their path that runs the module & returns
+	its exports.
+*/
+function compileModule(ast, path, entry) {
+	reset()
+
+	if (entry) return compileProgram(ast, '#include "runtime.h"')
+
+	const [module] = analyzeProgram(
+		[
+			{
+				expression: {
+					parameters: [],
+					body: { statements: ast, type: 'Block' },
+					type: 'FunctionExpression',
+				},
+				type: 'ExpressionStatement',
+			},
+		],
+		true
+	)
+	optimize([module])
+	inferTypes([module])
+
+	const { parameters, body, func } = module.expression
+	func.name = moduleName(path)
+	fnDecls.push({ parameters, body, func })
+
+	const functions = compileFunctions()
+
+	return `
+#include "runtime.h"
+
+${declarations()}
+
+${functions}
+
+// symbols are interned the first time the module is imported
+static void linx__intern_symbols() {
+	static bool interned = false;
+	if (interned) return;
+	interned = true;
+	${internSymbols()}
+}
+
+${definition(func, 'linx__intern_symbols();')}`
+}
+
+module.exports = { compile, compileModule }
@@ -1,7 +1,8 @@
 class Environment {
 	constructor(enclosing) {
 		this.enclosing = enclosing ? enclosing : null
-		this.values = {}
+		// no prototype, names like `toString` aren't defined in every scope
+		this.values = Object.create(null)
 		this.steps = 0
 	}
 
@@ -44,7 +45,7 @@ class Environment {
 
 	clone() {
 		let result = new Environment()
-		result.values = { ...this.values }
+		result.values = Object.assign(Object.create(null), this.values)
 		result.enclosing =
 			this.enclosing === null ? null : this.enclosing.clone()
 		return result
@@ -0,0 +1,263 @@
+/*
+	flow sensitive type inference for the C backend. runs after the analyzer
+	& annotates every expression with the type it's known to have at that
+	point in the program (`node.inferred`, one of 'number', 'bool', 'string',
+	'list', 'object', 'function' or 'nil', `null` when it could be anything).
+
+	it also decides which variables can be "unboxed": variables that aren't
+	captured by a closure & only ever hold numbers (or only booleans) are
+	compiled to plain C `double`/`bool` locals.
+*/
+
+const { builtinArity } = require('./builtins')
+
+// the known type of every variable binding at the current point
+let state = new Map()
+
+// every binding that's been assigned to, with all the types it's been given
+let assignedTypes = new Map()
+
+function join(a, b) {
+	return a === b ? a : null
+}
+
+// the state after control flow from two different paths meets again
+function merge(a, b) {
+	let result = new Map()
+	for (const [binding, type] of a) {
+		if (b.has(binding)) result.set(binding, join(type, b.get(binding)))
+	}
+	return result
+}
+
+function same(a, b) {
+	if (a.size !== b.size) return false
+	for (const [binding, type] of a) {
+		if (!b.has(binding) || b.get(binding) !== type) return false
+	}
+	return true
+}
+
+function assign(binding, type) {
+	if (!binding) return
+
+	state.set(binding, type)
+	assignedTypes.set(
+		binding,
+		assignedTypes.has(binding) ? join(assignedTypes.get(binding), type) : type
+	)
+
+	// constants never change, so closures can rely on their type too
+	if (!binding.mutable) binding.declaredType = type
+}
+
+function lookup(binding) {
+	if (!binding) return null
+
+	// captured variables can be changed by any call
+	if (binding.captured && binding.mutable) return null
+	if (state.has(binding)) return state.get(binding)
+	if (!binding.mutable && binding.declaredType) return binding.declaredType
+
+	return null
+}
+
+// runs `fn` until the types in the state stop changing, for loops
+function fixpoint(fn) {
+	let entry = state
+	while (true) {
+		state = new Map(entry)
+		const exit = fn()
+		const next = merge(entry, state)
+
+		if (same(next, entry)) {
+			state = exit
+			return
+		}
+		entry = next
+	}
+}
+
+function inferFunction(func, parameters, body) {
+	let prevState = state
+	state = new Map()
+
+	if (func.self) assign(func.self, 'function')
+	func.parameterBindings.forEach((binding) => assign(binding, null))
+	body.statements.forEach(inferStatement)
+
+	state = prevState
+}
+
+const statementVisitor = {
+	FunctionDeclaration: ({ parameters, body, func, binding }) => {
+		assign(binding, 'function')
+		inferFunction(func, parameters, body)
+	},
+	VariableDeclaration: ({ initializer, binding }) => {
+		assign(binding, infer(initializer))
+	},
+	ConstantDeclaration: ({ initializer, binding }) => {
+		assign(binding, infer(initializer))
+	},
+
+	ExpressionStatement: ({ expression }) => infer(expression),
+	PrintStatement: ({ expression }) => infer(expression),
+	ReturnStatement: ({ expression }) => infer(expression),
+	IfStatement: ({ condition, thenBlock, elseBlock }) => {
+		infer(condition)
+
+		let before = state
+		state = new Map(before)
+		inferStatement(thenBlock)
+		let afterThen = state
+
+		state = new Map(before)
+		if (elseBlock) inferStatement(elseBlock)
+		state = merge(afterThen, state)
+	},
+	WhileStatement: ({ condition, body }) => {
+		fixpoint(() => {
+			infer(condition)
+			const exit = new Map(state)
+			inferStatement(body)
+			return exit
+		})
+	},
+	ForStatement: ({ iterable, body, binding, rangeLoop }) => {
+		infer(iterable)
+		fixpoint(() => {
+			const exit = new Map(state)
+			assign(binding, rangeLoop ? 'number' : null)
+			inferStatement(body)
+			return exit
+		})
+	},
+	Block: ({ statements }) => {
+		statements.forEach(inferStatement)
+	},
+}
+
+function inferStatement(node) {
+	if (node && node.type in statementVisitor) {
+		statementVisitor[node.type](node)
+	}
+}
+
+const arithmetic = ['-', '*', '/']
+
+const expressionVisitor = {
+	AssignmentExpression: ({ target, value }) => {
+		const type = infer(value)
+
+		if (target.type === 'VariableExpression') {
+			assign(target.binding, type)
+		} else {
+			infer(target)
+		}
+
+		return type
+	},
+	BinaryExpression: ({ left, operator, right }) => {
+		const lhs = infer(left)
+		const rhs = infer(right)
+
+		if (operator.lexeme === '+') {
+			if (lhs === 'number' && rhs === 'number') return 'number'
+			if (lhs === 'string' || rhs === 'string') return 'string'
+			return null
+		}
+
+		if (arithmetic.includes(operator.lexeme)) {
+			return lhs === 'number' && rhs === 'number' ? 'number' : null
+		}
+
+		// comparisons, `and` & `or` always result in a boolean
+		return 'bool'
+	},
+	UnaryExpression: ({ operator, expression }) => {
+		const type = infer(expression)
+
+		if (operator.lexeme === '!') return 'bool'
+		return type === 'number' ? 'number' : null
+	},
+	IndexExpression: ({ array, index }) => {
+		infer(array)
+		infer(index)
+		return null
+	},
+	GetExpression: ({ object }) => {
+		infer(object)
+		return null
+	},
+	CallExpression: ({ callee, args }) => {
+		infer(callee)
+		const types = args.map(infer)
+
+		switch (callee.builtin) {
+			case 'len':
+				return ['list', 'string', 'object'].includes(types[0])
+					? 'number'
+					: null
+			case 'type':
+			case 'toString':
+				return 'string'
+			default:
+				return null
+		}
+	},
+	FunctionExpression: ({ parameters, body, func }) => {
+		inferFunction(func, parameters, body)
+		return 'function'
+	},
+	VariableExpression: ({ binding, builtin }) => {
+		if (builtin) return builtin in builtinArity ? 'function' : 'object'
+		return lookup(binding)
+	},
+	GroupExpression: ({ expression }) => infer(expression),
+
+	ArrayLiteral: ({ values }) => {
+		values.forEach(infer)
+		return 'list'
+	},
+	ObjectLiteral: ({ pairs }) => {
+		pairs.forEach((pair) => infer(pair[1]))
+		return 'object'
+	},
+	Literal: ({ value }) => {
+		switch (typeof value) {
+			case 'number':
+				return 'number'
+			case 'string':
+				return 'string'
+			case 'boolean':
+				return 'bool'
+			default:
+				return 'nil'
+		}
+	},
+}
+
+function infer(node) {
+	if (!node || !(node.type in expressionVisitor)) return null
+
+	node.inferred = expressionVisitor[node.type](node)
+	return node.inferred
+}
+
+function inferTypes(ast) {
+	state = new Map()
+	assignedTypes = new Map()
+
+	ast.forEach(inferStatement)
+
+	for (const [binding, type] of assignedTypes) {
+		if ((type === 'number' || type === 'bool') && !binding.captured) {
+			binding.unboxed = type
+		}
+	}
+
+	return ast
+}
+
+module.exports = { inferTypes }
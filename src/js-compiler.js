@@ -6,6 +6,10 @@ const { Lexer } = require('./lexer')
 const { Parser } = require('./parser')
 const { bundle } = require('./bundler')
 const { analyze } = require('./analyzer')
+const { optimize } = require('./optimizer')
+const { createCounter } = require('./util')
+
+const iteratorCount = createCounter(0)
 
 function binaryOp(left, operator, right) {
 	let op = ''
@@ -13,8 +17,13 @@ function binaryOp(left, operator, right) {
 	const operatorFunctionMap = {
 		and: '&&',
 		or: '||',
-		'==': '===',
-		'!=': '!==',
+	}
+
+	// lists & objects are compared by their contents
+	if (operator.lexeme === '==' || operator.lexeme === '!=') {
+		return `${operator.lexeme === '!=' ? '!' : ''}linx__equals(${codegen(
+			left
+		)}, ${codegen(right)})`
 	}
 
 	if (operator.lexeme in operatorFunctionMap) {
@@ -63,7 +72,7 @@ const codegenVisitor = {
 		return `return ${codegen(expression)};`
 	},
 	ForStatement: (ident, iterable, body) => {
-		let iteratorSignature = Date.now()
+		let iteratorSignature = iteratorCount()
 
 		/*
 
@@ -89,13 +98,16 @@ const codegenVisitor = {
 			with a temporary iterator name that has the value of `iterator(iterable)`
 			& then wrapping user-programmer code in the `while` block with an additional
 			variable declaration to put `ident` in the for-loop body scope.
+			iterator objects (like the ones `fs.lines` returns) are their own
+			iterator, values that can't be iterated over give `nil` & the loop
+			doesn't run.
 		*/
 
 		return `let iterator__${iteratorSignature} = iterator(${codegen(
 			iterable
 		)})
         
-        while (iterator__${iteratorSignature}.valid()) {
+        while (iterator__${iteratorSignature} !== null && iterator__${iteratorSignature}.valid()) {
             let ${ident.lexeme} = iterator__${iteratorSignature}.next();
             ${body.statements.map(codegen).join('\n')}
         }`
@@ -183,6 +195,7 @@ function compile(source, path) {
 	let ast = parser.parse()
 	ast = bundle(ast, path)
 	ast = analyze(ast, false)
+	ast = optimize(ast)
 
 	// console.log(ast)
 
@@ -5,36 +5,67 @@ function panic(line, message) {
 	process.exit(1)
 }
 
-function isDigit(string) {
-	return /^\d$/.test(string)
+/*
+	the class of every ASCII character, indexed by its char code. the lexer
+	looks characters up in here instead of testing them against regexes.
+*/
+const DIGIT = 1
+const ALPHA = 2
+
+const charClasses = new Uint8Array(128)
+for (let code = 48; code <= 57; code++) charClasses[code] = DIGIT
+for (let code = 65; code <= 90; code++) charClasses[code] = ALPHA
+for (let code = 97; code <= 122; code++) charClasses[code] = ALPHA
+
+// `NaN` (past the end of the source) & non ASCII codes are in no class
+function isDigit(code) {
+	return charClasses[code] === DIGIT
 }
 
-function isAlpha(string) {
-	return /^[A-Za-z]+$/.test(string)
+function isAlpha(code) {
+	return charClasses[code] === ALPHA
 }
 
-function isAlphaNumeric(string) {
-	return isAlpha(string) || isDigit(string)
+function isAlphaNumeric(code) {
+	return charClasses[code] > 0
 }
 
-const keywords = [
-	'and',
-	'else',
-	'false',
-	'for',
-	'fn',
-	'if',
-	'nil',
-	'or',
-	'print',
-	'return',
-	'true',
-	'let',
-	'while',
-	'in',
-	'import',
-	'export',
-]
+// the token type of every keyword
+const keywords = new Map(
+	[
+		'and',
+		'else',
+		'false',
+		'for',
+		'fn',
+		'if',
+		'nil',
+		'or',
+		'print',
+		'return',
+		'true',
+		'let',
+		'while',
+		'in',
+		'import',
+		'export',
+	].map((keyword) => [keyword, keyword.toUpperCase()])
+)
+
+// the tokens made of a single character
+const singleCharTokens = new Map([
+	['(', 'LEFT_PAREN'],
+	[')', 'RIGHT_PAREN'],
+	['{', 'LEFT_BRACE'],
+	['}', 'RIGHT_BRACE'],
+	['[', 'LEFT_BRACKET'],
+	[']', 'RIGHT_BRACKET'],
+	[',', 'COMMA'],
+	['.', 'DOT'],
+	['-', 'MINUS'],
+	['+', 'PLUS'],
+	['*', 'STAR'],
+])
 
 class Lexer {
 	constructor(source) {
@@ -78,28 +109,26 @@ class Lexer {
 		return true
 	}
 
-	peek() {
-		if (this.isAtEnd()) return '\0'
-		return this.source[this.current]
+	// char codes are `NaN` past the end, which isn't in any class
+	peekCode() {
+		return this.source.charCodeAt(this.current)
 	}
 
-	peekNext() {
-		if (this.current + 1 >= this.source.length) return '\0'
-		return this.source[this.current + 1]
+	peekNextCode() {
+		return this.source.charCodeAt(this.current + 1)
 	}
 
 	interpolation() {
 		// skip the '${'
-		this.advance()
-		this.advance()
+		this.current += 2
 
-		while (this.peek() !== '}' && !this.isAtEnd()) {
+		while (this.source[this.current] !== '}' && !this.isAtEnd()) {
 			this.start = this.current
 			this.scanToken()
 		}
 
 		this.start = this.current
-		this.advance() // skip the '}'
+		this.current++ // skip the '}'
 
 		this.tokens.push(
 			new Token(
@@ -114,15 +143,17 @@ class Lexer {
 	}
 
 	string() {
-		while (this.peek() !== '"' && !this.isAtEnd()) {
-			if (this.peek() === '\n') {
+		const source = this.source
+
+		while (this.current < source.length) {
+			const c = source[this.current]
+
+			if (c === '"') break
+			if (c === '\n') {
 				this.line++
 				this.lineBegin = this.current
-			} else if (this.peek() === '$' && this.peekNext() === '{') {
-				const value = this.source.substring(
-					this.start + 1,
-					this.current
-				)
+			} else if (c === '$' && source[this.current + 1] === '{') {
+				const value = source.substring(this.start + 1, this.current)
 				this.addToken('STRING', value)
 				this.tokens.push(
 					new Token(
@@ -137,7 +168,7 @@ class Lexer {
 				return this.interpolation()
 			}
 
-			this.advance()
+			this.current++
 		}
 
 		// Unterminated string.
@@ -147,22 +178,22 @@ class Lexer {
 		}
 
 		// The closing ".
-		this.advance()
+		this.current++
 
 		// Trim the surrounding quotes.
-		const value = this.source.substring(this.start + 1, this.current - 1)
+		const value = source.substring(this.start + 1, this.current - 1)
 		this.addToken('STRING', value)
 	}
 
 	number() {
-		while (isDigit(this.peek())) this.advance()
+		while (isDigit(this.peekCode())) this.current++
 
 		// Look for a fractional part.
-		if (this.peek() == '.' && isDigit(this.peekNext())) {
+		if (this.source[this.current] === '.' && isDigit(this.peekNextCode())) {
 			// Consume the "."
-			this.advance()
+			this.current++
 
-			while (isDigit(this.peek())) this.advance()
+			while (isDigit(this.peekCode())) this.current++
 		}
 
 		this.addToken(
@@ -172,55 +203,25 @@ class Lexer {
 	}
 
 	identifier() {
-		while (isAlphaNumeric(this.peek())) this.advance()
+		while (isAlphaNumeric(this.peekCode())) this.current++
 
 		const text = this.source.substring(this.start, this.current)
-
-		let type = keywords.find((el) => el === text)
-		if (!type) type = 'IDENTIFIER'
-		this.addToken(type.toUpperCase())
+		this.addToken(keywords.get(text) || 'IDENTIFIER')
 	}
 
 	scanToken() {
 		const c = this.advance()
 
+		const single = singleCharTokens.get(c)
+		if (single !== undefined) {
+			this.addToken(single)
+			return
+		}
+
 		switch (c) {
 			case ':':
 				this.addToken(this.match('=') ? 'COLON_EQUAL' : 'COLON')
 				break
-			case '(':
-				this.addToken('LEFT_PAREN')
-				break
-			case ')':
-				this.addToken('RIGHT_PAREN')
-				break
-			case '{':
-				this.addToken('LEFT_BRACE')
-				break
-			case '}':
-				this.addToken('RIGHT_BRACE')
-				break
-			case '[':
-				this.addToken('LEFT_BRACKET')
-				break
-			case ']':
-				this.addToken('RIGHT_BRACKET')
-				break
-			case ',':
-				this.addToken('COMMA')
-				break
-			case '.':
-				this.addToken('DOT')
-				break
-			case '-':
-				this.addToken('MINUS')
-				break
-			case '+':
-				this.addToken('PLUS')
-				break
-			case '*':
-				this.addToken('STAR')
-				break
 			case '!':
 				this.addToken(this.match('=') ? 'BANG_EQUAL' : 'BANG')
 				break
@@ -236,10 +237,8 @@ class Lexer {
 			case '/':
 				if (this.match('/')) {
 					// A comment goes until the end of the line.
-					while (this.peek() != '\n' && !this.isAtEnd())
-						this.advance()
-				} else if (isAlpha(c)) {
-					identifier()
+					const end = this.source.indexOf('\n', this.current)
+					this.current = end === -1 ? this.source.length : end
 				} else {
 					this.addToken('SLASH')
 				}
@@ -256,15 +255,17 @@ class Lexer {
 			case '"':
 				this.string()
 				break
-			default:
-				if (isDigit(c)) {
+			default: {
+				const code = c.charCodeAt(0)
+				if (isDigit(code)) {
 					this.number()
-				} else if (isAlpha(c)) {
+				} else if (isAlpha(code)) {
 					this.identifier()
 				} else {
 					panic(this.line, 'Unexpected character: ' + c)
 				}
 				break
+			}
 		}
 	}
 
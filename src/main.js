@@ -1,12 +1,14 @@
 const { join, resolve } = require('path')
-const { spawn } = require('child_process')
-const { readFileSync, existsSync, writeFileSync, mkdirSync } = require('fs')
+const { readFileSync, existsSync } = require('fs')
 
 const { compile } = require('./compiler')
 const { compile: compileJS } = require('./js-compiler')
+const { bench } = require('./bench')
+const { test } = require('./test')
+const { build } = require('./build')
 
 const progName = 'linx'
-const commands = ['run', 'compile', 'emit-c', 'emit-js']
+const commands = ['run', 'compile', 'emit-c', 'emit-js', 'bench', 'test']
 const args = process.argv.slice(2)
 
 const globalHelpText = `
@@ -18,6 +20,8 @@ const globalHelpText = `
     compile    Compiles the Linx file to an executable.
     emit-c     Writes compiled C code to stdout.
     emit-js    Writes compile JS code to stdout.
+    bench      Measures the performance of Linx programs.
+    test       Runs the tests of the compiler & runtimes.
 
   For more info, run any command with the \`--help\` flag
     $ ${progName} run --help`
@@ -34,22 +38,111 @@ const commandHelpTexts = {
     Compiles the provided Linx file to C & then uses the
     systems C compiler to compile to an executable.
 
+    Every module is compiled separately & cached in \`tmp/cache/\`,
+    rebuilds only recompile the modules that changed. Programs are
+    optimized & linked with the prebuilt runtime library by default.
+
   Usage
     $ ${progName} compile <filename> [options]
 
   Options
-    --cc    The program to use instead of $CC to compile the C code.`,
+    --cc         The program to use instead of $CC to compile the C code.
+    --debug      Builds without optimizations & with debug info.
+    --pgo        Builds the program with profile guided optimization: an
+                 instrumented build is run once (without arguments) to
+                 record a profile, then the program is rebuilt using it.
+    --profile    Builds the program with the runtime's profiler. Run it
+                 with \`LINX_PROFILE=1\` for a summary of allocations,
+                 operator calls, object lookups & copies on exit, or with
+                 \`LINX_PROFILE=<file>.json\` (or any other file for a
+                 flamegraph compatible report) to write it to a file.`,
 	'emit-c': ``,
+	bench: `
+  Description
+    Compiles each program with the C backend & runs it through the
+    JS backend, reporting wall time, peak memory & allocations.
+
+  Usage
+    $ ${progName} bench [files or directories] [options]
+
+    Defaults to the programs in \`benchmarks/\`.
+
+  Options
+    --runs       Number of measured runs of each program (default 5).
+    --warmup     Number of runs before measuring (default 1).
+    --backend    Only run the given backend, \`c\` or \`js\`.
+    --cc         The program to use instead of $CC to compile the C code.
+    --json       Writes the results to stdout as JSON.`,
+	test: `
+  Description
+    Runs each test program with the C & JS backends, comparing its
+    output with the \`.out\` file next to it, & runs the test scripts
+    (\`.js\` files) with node.
+
+  Usage
+    $ ${progName} test [files or directories] [options]
+
+    Defaults to the tests in \`tests/\`.
+
+  Options
+    --backend    Only run the given backend, \`c\` or \`js\`.
+    --cc         The program to use instead of $CC to compile the C code.
+    --cflags     Extra flags for the C compiler, e.g. a sanitizer or the
+                 \`-I\` of the directory with gc.h.`,
 }
 
-if (!commands.includes(args[0])) {
-	console.log(globalHelpText)
-	process.exit(1)
-} else {
-	if (args.includes('--help') || args.includes('-h')) {
-		console.log(commandHelpTexts[args[0]])
-		process.exit(0)
-	} else if (args.length < 2) {
+// the value following `flag` in the arguments
+function option(flag, fallback) {
+	return args.includes(flag) ? args[args.indexOf(flag) + 1] : fallback
+}
+
+function benchCommand() {
+	const flags = ['--runs', '--warmup', '--backend', '--cc']
+	const paths = args
+		.slice(1)
+		.filter(
+			(arg, i, rest) =>
+				!arg.startsWith('--') && !flags.includes(rest[i - 1])
+		)
+
+	bench(paths.length > 0 ? paths : [join(__dirname, '../benchmarks')], {
+		runs: Number(option('--runs', 5)),
+		warmup: Number(option('--warmup', 1)),
+		backends: args.includes('--backend')
+			? [option('--backend')]
+			: ['c', 'js'],
+		cc: option('--cc', 'cc'),
+		json: args.includes('--json'),
+	}).then(
+		() => process.exit(0),
+		(error) => {
+			console.error(error.message)
+			process.exit(1)
+		}
+	)
+}
+
+function testCommand() {
+	const flags = ['--backend', '--cc', '--cflags']
+	const paths = args
+		.slice(1)
+		.filter(
+			(arg, i, rest) =>
+				!arg.startsWith('--') && !flags.includes(rest[i - 1])
+		)
+
+	test(paths.length > 0 ? paths : [join(__dirname, '../tests')], {
+		backends: args.includes('--backend')
+			? [option('--backend')]
+			: ['c', 'js'],
+		cc: option('--cc', 'cc'),
+		flags: option('--cflags', '').split(/\s+/).filter(Boolean),
+	}).then((passed) => process.exit(passed ? 0 : 1))
+}
+
+// the commands that take a file: run, compile, emit-c & emit-js
+function fileCommand() {
+	if (args.length < 2) {
 		console.log(commandHelpTexts[args[0]])
 		process.exit(1)
 	}
@@ -68,39 +161,28 @@ if (!commands.includes(args[0])) {
 			break
 		}
 		case 'compile': {
-			const c = compile(fileContents, resolve(fileName))
-
-			if (!existsSync(join(__dirname, '../tmp'))) {
-				mkdirSync(join(__dirname, '../tmp'))
-			}
-			writeFileSync(join(__dirname, '../tmp/tempcache.c'), c)
-
-			let cc = 'cc'
-			if (args.includes('--cc')) {
-				cc = args[args.indexOf('--cc') + 1]
-			}
-
-			const compileCommand = spawn(
-				cc,
-				[
-					join(__dirname, '../tmp/tempcache.c'),
+			build(fileName, {
+				cc: option('--cc', 'cc'),
+				mode: args.includes('--debug') ? 'debug' : 'release',
+				pgo: args.includes('--pgo'),
+				output: 'a.out',
+				flags: [
 					'-Wall',
 					'-Wpedantic',
 					'-std=c99',
+					...(args.includes('--profile') ? ['-DLINX_PROFILE'] : []),
 				],
-				{
-					cwd: process.cwd(),
-					stdio: 'inherit',
-				}
-			)
-
-			compileCommand.on('close', (code) => {
-				if (code === 0) {
+			}).then(
+				() => {
 					console.log(
 						'Program was compiled to executable successfully!'
 					)
+				},
+				(error) => {
+					console.error(error.message)
+					process.exit(1)
 				}
-			})
+			)
 
 			break
 		}
@@ -114,3 +196,17 @@ if (!commands.includes(args[0])) {
 		}
 	}
 }
+
+if (!commands.includes(args[0])) {
+	console.log(globalHelpText)
+	process.exit(1)
+} else if (args.includes('--help') || args.includes('-h')) {
+	console.log(commandHelpTexts[args[0]])
+	process.exit(0)
+} else if (args[0] === 'bench') {
+	benchCommand()
+} else if (args[0] === 'test') {
+	testCommand()
+} else {
+	fileCommand()
+}
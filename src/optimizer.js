@@ -0,0 +1,541 @@
+/*
+	optimizations on the analyzed AST, shared by both backends. runs after
+	the analyzer & before codegen (& the C backend's type inference), every
+	pass changes the AST in place:
+
+	- constant folding: operators on literals are computed at compile time,
+	  where both backends would compute the same result.
+	- dead branches: `if`s & `while`s with a literal condition lose the
+	  branches that can never run.
+	- unused declarations: variables & functions that nothing refers to are
+	  removed, if creating them has no side effects.
+	- loop invariant calls: pure builtin calls in a loop whose arguments
+	  can't change while it runs (the `len(list)` in `while i < len(list)`)
+	  are made once before the loop, identical calls share the result.
+*/
+
+const { childFields } = require('./walk')
+const { Token } = require('./token')
+const { createCounter } = require('./util')
+
+let hoistedCount = createCounter(0)
+
+// rewrites `node` bottom up, `fn` returns the replacement for each node
+function transform(node, fn, enter = () => true) {
+	if (Array.isArray(node)) {
+		for (let i = 0; i < node.length; i++) {
+			node[i] = transform(node[i], fn, enter)
+		}
+		return node
+	}
+
+	if (!node || !enter(node)) return node
+
+	if (node.type === 'ObjectLiteral') {
+		node.pairs.forEach((pair) => {
+			pair[1] = transform(pair[1], fn, enter)
+		})
+	} else if (node.type in childFields) {
+		for (const field of childFields[node.type]) {
+			node[field] = transform(node[field], fn, enter)
+		}
+	}
+
+	return fn(node)
+}
+
+function forEachNode(node, fn, enter) {
+	transform(
+		node,
+		(child) => {
+			fn(child)
+			return child
+		},
+		enter
+	)
+}
+
+const outsideFunctions = (node) =>
+	node.type !== 'FunctionExpression' && node.type !== 'FunctionDeclaration'
+
+/* <-- constant folding & dead branches --> */
+
+// the literal `node` evaluates to, looking through parentheses
+function literalOf(node) {
+	while (node && node.type === 'GroupExpression') node = node.expression
+	return node && node.type === 'Literal' ? node : null
+}
+
+// the same as the runtimes' truthiness, for the values literals can have
+function truthy(value) {
+	if (typeof value === 'number') return value !== 0
+	if (typeof value === 'string') return value.length !== 0
+	return value !== null && value !== false
+}
+
+/*
+	numbers that can't be written as a literal in both backends' output
+	(infinities, NaN & -0) are left for the program to compute.
+*/
+function literal(value, node) {
+	if (
+		value === undefined ||
+		(typeof value === 'number' &&
+			(!Number.isFinite(value) || Object.is(value, -0)))
+	) {
+		return node
+	}
+
+	return { value, type: 'Literal' }
+}
+
+/*
+	the backends only agree on some operators: the C runtime's `and`/`or`
+	always result in a boolean while JS's return an operand, strings are
+	compared differently, etc. the rest are left alone.
+*/
+function foldBinary(node) {
+	const left = literalOf(node.left)
+	const right = literalOf(node.right)
+	if (!left || !right) return node
+
+	const a = left.value
+	const b = right.value
+	const numbers = typeof a === 'number' && typeof b === 'number'
+	const booleans = typeof a === 'boolean' && typeof b === 'boolean'
+
+	switch (node.operator.lexeme) {
+		case '+':
+			if (numbers) return literal(a + b, node)
+
+			// string literals keep their escapes, so one can't end in half of one
+			if (
+				typeof a === 'string' &&
+				typeof b === 'string' &&
+				!a.endsWith('\\')
+			) {
+				return literal(a + b, node)
+			}
+			return node
+		case '-':
+			return numbers ? literal(a - b, node) : node
+		case '*':
+			return numbers ? literal(a * b, node) : node
+		case '/':
+			return numbers ? literal(a / b, node) : node
+		case '<':
+			return numbers ? literal(a < b, node) : node
+		case '>':
+			return numbers ? literal(a > b, node) : node
+		case '<=':
+			return numbers ? literal(a <= b, node) : node
+		case '>=':
+			return numbers ? literal(a >= b, node) : node
+		case '==':
+			return literal(a === b, node)
+		case '!=':
+			return literal(a !== b, node)
+		case 'and':
+			return booleans ? literal(a && b, node) : node
+		case 'or':
+			return booleans ? literal(a || b, node) : node
+		default:
+			return node
+	}
+}
+
+function foldUnary(node) {
+	const operand = literalOf(node.expression)
+	if (!operand) return node
+
+	if (node.operator.lexeme === '!') return literal(!truthy(operand.value), node)
+	if (typeof operand.value === 'number') return literal(-operand.value, node)
+	return node
+}
+
+const emptyBlock = () => ({ statements: [], type: 'Block' })
+
+const foldVisitor = {
+	BinaryExpression: foldBinary,
+	UnaryExpression: foldUnary,
+	IfStatement: (node) => {
+		const condition = literalOf(node.condition)
+		if (!condition) return node
+
+		if (truthy(condition.value)) return node.thenBlock
+		return node.elseBlock || emptyBlock()
+	},
+	WhileStatement: (node) => {
+		const condition = literalOf(node.condition)
+		return condition && !truthy(condition.value) ? emptyBlock() : node
+	},
+}
+
+function fold(ast) {
+	return transform(ast, (node) =>
+		node.type in foldVisitor ? foldVisitor[node.type](node) : node
+	)
+}
+
+/* <-- unused declarations --> */
+
+// builtins that only compute a result from their arguments
+const pureBuiltins = [
+	'len',
+	'type',
+	'range',
+	'toString',
+	'keys',
+	'iterator',
+	'sort',
+]
+
+// operators that can't fail on numbers, & only compute a number or boolean
+const numberOperators = ['+', '-', '*', '/', '<', '>', '<=', '>=', '==', '!=']
+
+/*
+	whether `node` is always a number. the optimizer runs before type
+	inference, so only literals & arithmetic on them are known to be.
+*/
+function isNumber(node) {
+	switch (node.type) {
+		case 'Literal':
+			return typeof node.value === 'number'
+		case 'GroupExpression':
+			return isNumber(node.expression)
+		case 'UnaryExpression':
+			return node.operator.lexeme === '-' && isNumber(node.expression)
+		case 'BinaryExpression':
+			return (
+				['+', '-', '*', '/'].includes(node.operator.lexeme) &&
+				isNumber(node.left) &&
+				isNumber(node.right)
+			)
+		default:
+			return false
+	}
+}
+
+/*
+	whether evaluating `node` has no effects other than its result. reading
+	a property or an index can fail, & so can operators on anything but
+	numbers, so only operators on numbers are.
+*/
+function isPure(node) {
+	if (!node) return true
+
+	switch (node.type) {
+		case 'Literal':
+		case 'VariableExpression':
+		case 'FunctionExpression':
+			return true
+		case 'GroupExpression':
+			return isPure(node.expression)
+		case 'UnaryExpression':
+			return isNumber(node)
+		case 'BinaryExpression':
+			return (
+				numberOperators.includes(node.operator.lexeme) &&
+				isNumber(node.left) &&
+				isNumber(node.right)
+			)
+		case 'ArrayLiteral':
+			return node.values.every(isPure)
+		case 'ObjectLiteral':
+			return node.pairs.every((pair) => isPure(pair[1]))
+		case 'CallExpression':
+			return (
+				pureBuiltins.includes(node.callee.builtin) &&
+				node.args.every(isPure)
+			)
+		default:
+			return false
+	}
+}
+
+const declarations = [
+	'FunctionDeclaration',
+	'VariableDeclaration',
+	'ConstantDeclaration',
+]
+
+/*
+	captured variables are left, closures that captured them in a removed
+	branch still have them in their environment. so are names the analyzer
+	couldn't resolve (see `VariableExpression` in the analyzer).
+*/
+function isUnused(statement, uses, unresolved) {
+	const { binding, ident } = statement
+
+	return (
+		declarations.includes(statement.type) &&
+		binding &&
+		!binding.captured &&
+		!uses.has(binding) &&
+		!unresolved.has(ident.lexeme) &&
+		(statement.type === 'FunctionDeclaration' ||
+			isPure(statement.initializer))
+	)
+}
+
+// removes unused declarations until there are none left
+function removeUnused(ast) {
+	let removed = true
+
+	while (removed) {
+		removed = false
+
+		let uses = new Set()
+		let unresolved = new Set()
+		forEachNode(ast, (node) => {
+			if (node.type !== 'VariableExpression') return
+			if (node.binding) uses.add(node.binding)
+			else unresolved.add(node.ident.lexeme)
+		})
+
+		const used = (statement) => {
+			if (!isUnused(statement, uses, unresolved)) return true
+			removed = true
+			return false
+		}
+
+		ast = ast.filter(used)
+		forEachNode(ast, (node) => {
+			if (node.type === 'Block') node.statements = node.statements.filter(used)
+		})
+	}
+
+	return ast
+}
+
+/* <-- loop invariant calls --> */
+
+// builtins worth hoisting, their results can't be changed through an alias
+const hoistedBuiltins = ['len', 'type', 'toString']
+
+// builtins that call a function they're given
+const callingBuiltins = ['sortBy']
+
+// ranges, list literals & strings are the only things known not to be one
+const mightCallIterator = (loop) =>
+	loop.type === 'ForStatement' &&
+	!loop.rangeLoop &&
+	loop.iterable.type !== 'ArrayLiteral' &&
+	!(loop.iterable.type === 'Literal' && typeof loop.iterable.value === 'string')
+
+/*
+	what a loop (its condition & body, not the functions in it) declares &
+	assigns. calls to functions (which could assign anything) & assignments
+	into lists or objects (which change them through every alias in JS)
+	make a loop unsafe to hoist anything out of. that includes builtins that
+	call back into the program, `lists.map` & the other functions of builtin
+	objects are called through a property so they always count. so do `for`
+	loops that might go through an iterator object, they call its `valid` &
+	`next` on every iteration.
+*/
+function loopEffects(loop) {
+	let effects = { declared: new Set(), assigned: new Set(), unsafe: false }
+	if (loop.binding) effects.declared.add(loop.binding)
+	if (mightCallIterator(loop)) effects.unsafe = true
+
+	const parts =
+		loop.type === 'WhileStatement' ? [loop.condition, loop.body] : [loop.body]
+	forEachNode(
+		parts,
+		(node) => {
+			if (declarations.includes(node.type) || node.type === 'ForStatement') {
+				effects.declared.add(node.binding)
+				if (mightCallIterator(node)) effects.unsafe = true
+			} else if (node.type === 'AssignmentExpression') {
+				if (node.target.type === 'VariableExpression') {
+					effects.assigned.add(node.target.binding)
+				} else {
+					effects.unsafe = true
+				}
+			} else if (
+				node.type === 'CallExpression' &&
+				(!node.callee.builtin || callingBuiltins.includes(node.callee.builtin))
+			) {
+				effects.unsafe = true
+			}
+		},
+		outsideFunctions
+	)
+
+	return effects
+}
+
+// whether `node` has the same value on every iteration of the loop
+function isInvariant(node, effects) {
+	switch (node.type) {
+		case 'Literal':
+			return true
+		case 'VariableExpression':
+			return (
+				node.binding !== undefined &&
+				!node.builtin &&
+				!effects.declared.has(node.binding) &&
+				!effects.assigned.has(node.binding)
+			)
+		case 'GroupExpression':
+		case 'UnaryExpression':
+			return isInvariant(node.expression, effects)
+		case 'BinaryExpression':
+			return (
+				isInvariant(node.left, effects) && isInvariant(node.right, effects)
+			)
+		case 'GetExpression':
+			return isInvariant(node.object, effects)
+		case 'IndexExpression':
+			return (
+				isInvariant(node.array, effects) && isInvariant(node.index, effects)
+			)
+		default:
+			return false
+	}
+}
+
+// identifies an invariant expression, the same key means the same value
+let bindingIds = new Map()
+
+function invariantKey(node) {
+	switch (node.type) {
+		case 'Literal':
+			return JSON.stringify(node.value)
+		case 'VariableExpression':
+			if (!bindingIds.has(node.binding)) {
+				bindingIds.set(node.binding, bindingIds.size)
+			}
+			return `$${bindingIds.get(node.binding)}`
+		case 'GroupExpression':
+			return invariantKey(node.expression)
+		case 'UnaryExpression':
+			return `(${node.operator.lexeme}${invariantKey(node.expression)})`
+		case 'BinaryExpression':
+			return `(${invariantKey(node.left)} ${
+				node.operator.lexeme
+			} ${invariantKey(node.right)})`
+		case 'GetExpression':
+			return `${invariantKey(node.object)}.${node.ident.lexeme}`
+		case 'IndexExpression':
+			return `${invariantKey(node.array)}[${invariantKey(node.index)}]`
+	}
+}
+
+// the nodes of a while loop's condition that are evaluated every time
+function alwaysEvaluated(node, nodes = new Set()) {
+	if (!node || node.type === 'FunctionExpression') return nodes
+	nodes.add(node)
+
+	if (
+		node.type === 'BinaryExpression' &&
+		(node.operator.lexeme === 'and' || node.operator.lexeme === 'or')
+	) {
+		return alwaysEvaluated(node.left, nodes)
+	}
+	if (node.type === 'ObjectLiteral') {
+		node.pairs.forEach((pair) => alwaysEvaluated(pair[1], nodes))
+	} else if (node.type in childFields) {
+		for (const field of childFields[node.type]) {
+			const child = node[field]
+			if (Array.isArray(child)) {
+				child.forEach((item) => alwaysEvaluated(item, nodes))
+			} else {
+				alwaysEvaluated(child, nodes)
+			}
+		}
+	}
+
+	return nodes
+}
+
+// arguments that can't raise an error when evaluated
+const isSimple = (node) =>
+	node.type === 'Literal' ||
+	node.type === 'VariableExpression' ||
+	(node.type === 'GroupExpression' && isSimple(node.expression))
+
+/*
+	replaces the invariant builtin calls in `loop` with constants, returns
+	their declarations (to go before the loop). the loop might not run at
+	all, so calls it doesn't always make are only hoisted when their
+	arguments can't fail (`len(list[0])` errors on an empty list).
+*/
+function hoistCalls(loop) {
+	const effects = loopEffects(loop)
+	if (effects.unsafe) return []
+
+	const evaluated =
+		loop.type === 'WhileStatement' ? alwaysEvaluated(loop.condition) : new Set()
+
+	let hoisted = new Map()
+	const replace = (node) => {
+		if (
+			node.type !== 'CallExpression' ||
+			!hoistedBuiltins.includes(node.callee.builtin) ||
+			!node.args.every((arg) => isInvariant(arg, effects))
+		) {
+			return node
+		}
+
+		const key = `${node.callee.builtin}(${node.args
+			.map(invariantKey)
+			.join(', ')})`
+		if (!hoisted.has(key)) {
+			if (!evaluated.has(node) && !node.args.every(isSimple)) return node
+
+			const name = `linx__hoisted${hoistedCount()}`
+			hoisted.set(key, {
+				ident: new Token('IDENTIFIER', name, null),
+				initializer: node,
+				binding: { value: null, mutable: false },
+				type: 'ConstantDeclaration',
+			})
+		}
+
+		const { ident, binding } = hoisted.get(key)
+		return {
+			ident,
+			binding,
+			builtin: undefined,
+			captured: undefined,
+			type: 'VariableExpression',
+		}
+	}
+
+	if (loop.type === 'WhileStatement') {
+		loop.condition = transform(loop.condition, replace, outsideFunctions)
+	}
+	loop.body = transform(loop.body, replace, outsideFunctions)
+
+	return [...hoisted.values()]
+}
+
+const loops = ['WhileStatement', 'ForStatement']
+
+function hoistStatements(statements) {
+	return statements.flatMap((statement) =>
+		loops.includes(statement.type)
+			? [...hoistCalls(statement), statement]
+			: [statement]
+	)
+}
+
+// inner loops first, so what they hoist can be hoisted further out
+function hoist(ast) {
+	forEachNode(ast, (node) => {
+		if (node.type === 'Block') node.statements = hoistStatements(node.statements)
+	})
+	return hoistStatements(ast)
+}
+
+function optimize(ast) {
+	hoistedCount = createCounter(0)
+	bindingIds = new Map()
+
+	ast = fold(ast)
+	ast = removeUnused(ast)
+	return hoist(ast)
+}
+
+module.exports = { optimize }
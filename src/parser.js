@@ -5,6 +5,14 @@ function panic(token, message) {
 	process.exit(1)
 }
 
+// the token types matched by each level of precedence
+const equalityOperators = ['BANG_EQUAL', 'EQUAL_EQUAL']
+const comparisonOperators = ['GREATER', 'GREATER_EQUAL', 'LESS', 'LESS_EQUAL']
+const additionOperators = ['MINUS', 'PLUS']
+const multiplicationOperators = ['SLASH', 'STAR']
+const unaryOperators = ['BANG', 'MINUS']
+const literalTokens = ['NUMBER', 'STRING']
+
 class Parser {
 	constructor(tokens) {
 		this.tokens = tokens || []
@@ -32,9 +40,9 @@ class Parser {
 		return this.previous()
 	}
 
+	// the EOF token never matches, nothing checks for it
 	check(type) {
-		if (this.isAtEnd()) return false
-		return this.peek().type === type
+		return this.tokens[this.current].type === type
 	}
 
 	consume(type, message) {
@@ -42,12 +50,17 @@ class Parser {
 		panic(this.peek(), message)
 	}
 
-	match(...types) {
-		for (const type of types) {
-			if (this.check(type)) {
-				this.advance()
-				return true
-			}
+	match(type) {
+		if (!this.check(type)) return false
+
+		this.current++
+		return true
+	}
+
+	// like `match` for any of the `types`, which are kept in constants
+	matchAny(types) {
+		for (let i = 0; i < types.length; i++) {
+			if (this.match(types[i])) return true
 		}
 
 		return false
@@ -277,7 +290,7 @@ class Parser {
 	equality() {
 		let expr = this.comparison()
 
-		while (this.match('BANG_EQUAL', 'EQUAL_EQUAL')) {
+		while (this.matchAny(equalityOperators)) {
 			const operator = this.previous()
 			const right = this.comparison()
 			expr = {
@@ -294,7 +307,7 @@ class Parser {
 	comparison() {
 		let expr = this.addition()
 
-		while (this.match('GREATER', 'GREATER_EQUAL', 'LESS', 'LESS_EQUAL')) {
+		while (this.matchAny(comparisonOperators)) {
 			const operator = this.previous()
 			const right = this.addition()
 			expr = {
@@ -311,7 +324,7 @@ class Parser {
 	addition() {
 		let expr = this.multiplication()
 
-		while (this.match('MINUS', 'PLUS')) {
+		while (this.matchAny(additionOperators)) {
 			const operator = this.previous()
 			const right = this.multiplication()
 			expr = {
@@ -328,7 +341,7 @@ class Parser {
 	multiplication() {
 		let expr = this.unary()
 
-		while (this.match('SLASH', 'STAR')) {
+		while (this.matchAny(multiplicationOperators)) {
 			const operator = this.previous()
 			const right = this.unary()
 			expr = {
@@ -343,12 +356,12 @@ class Parser {
 	}
 
 	unary() {
-		if (this.match('BANG', 'MINUS')) {
+		if (this.matchAny(unaryOperators)) {
 			const operator = this.previous()
 			const right = this.unary()
 			return {
 				operator,
-				right,
+				expression: right,
 				type: 'UnaryExpression',
 			}
 		}
@@ -488,7 +501,7 @@ class Parser {
 		if (this.match('TRUE')) return { value: true, type: 'Literal' }
 		if (this.match('NIL')) return { value: null, type: 'Literal' }
 
-		if (this.match('NUMBER', 'STRING')) {
+		if (this.matchAny(literalTokens)) {
 			return {
 				value: this.previous().literal,
 				type: 'Literal',
@@ -0,0 +1,79 @@
+const { join, resolve, basename, extname } = require('path')
+const {
+	readFileSync,
+	writeFileSync,
+	existsSync,
+	mkdirSync,
+	readdirSync,
+	statSync,
+} = require('fs')
+
+const { compile: compileJS } = require('./js-compiler')
+const { build } = require('./build')
+
+/*
+	the programs `linx bench` & `linx test` run, found in the files &
+	directories they're given & built for each backend into `tmp/`.
+*/
+
+const tmpDir = join(__dirname, '../tmp')
+
+// every file with one of `extensions` in the given files & directories
+function programFiles(paths, extensions) {
+	let files = []
+
+	paths.forEach((path) => {
+		if (!existsSync(path)) {
+			console.error('File does not exist:', path)
+			process.exit(1)
+		}
+
+		if (statSync(path).isDirectory()) {
+			readdirSync(path)
+				.sort()
+				.forEach((file) => {
+					const child = join(path, file)
+					if (statSync(child).isDirectory()) {
+						files.push(...programFiles([child], extensions))
+					} else if (extensions.includes(extname(file))) {
+						files.push(child)
+					}
+				})
+		} else {
+			files.push(path)
+		}
+	})
+
+	return files
+}
+
+/*
+	builds the program for `backend` to `tmp/<prefix>-<name>`, returns the
+	command that runs it. C programs are built like `linx compile` builds
+	them (through the module & runtime cache), with `options.flags` added
+	to the C compiler's. `options.footer` is added to the end of the JS.
+*/
+async function buildProgram(file, backend, options) {
+	if (!existsSync(tmpDir)) mkdirSync(tmpDir)
+	const output = join(tmpDir, `${options.prefix}-${basename(file, '.li')}`)
+
+	if (backend === 'js') {
+		const source = readFileSync(file, 'utf-8')
+		writeFileSync(
+			`${output}.js`,
+			compileJS(source, resolve(file)) + (options.footer || '')
+		)
+		return [process.execPath, [`${output}.js`]]
+	}
+
+	await build(file, {
+		cc: options.cc,
+		mode: 'release',
+		pgo: false,
+		output,
+		flags: ['-std=c99', ...options.flags],
+	})
+	return [output, []]
+}
+
+module.exports = { programFiles, buildProgram }
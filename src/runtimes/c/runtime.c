@@ -0,0 +1,3241 @@
+// mmap, madvise & friends aren't declared in strict C99 mode otherwise
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "runtime.h"
+
+tgc_t gc;
+HeapStats heap_stats;
+__thread Nursery nursery;
+
+bool linx_threads_active = false;
+pthread_mutex_t linx_heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+    guards the structures shared by every thread other than the heap: the
+    intern table, shape transitions & appends to shared string buffers.
+    it's always taken before `linx_heap_lock`, never while holding it.
+*/
+static pthread_mutex_t linx_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+#ifdef LINX_PROFILE
+Profile profile;
+#endif
+
+Value linx_nil = {.type = TYPE_NIL};
+Value linx_true = {.type = TYPE_BOOLEAN, .as.boolean = true};
+Value linx_false = {.type = TYPE_BOOLEAN, .as.boolean = false};
+
+Value* len__builtin;
+Value* type__builtin;
+Value* range__builtin;
+Value* toString__builtin;
+Value* keys__builtin;
+Value* iterator__builtin;
+Value* set__builtin;
+Value* map__builtin;
+Value* sort__builtin;
+Value* sortBy__builtin;
+Value* parallel__builtin;
+Value* fs__builtin;
+Value* lists__builtin;
+
+char* double_to_charptr(double num) {
+    int length = snprintf(NULL, 0, "%g", num);
+    char* str = linx_malloc(TYPE_STRING, length + 1);
+    snprintf(str, length + 1, "%g", num);
+    return str;
+}
+
+// FNV-1a
+size_t charptr_hash(const char* str, size_t length) {
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+
+    // 0 is reserved for strings whose hash hasn't been computed yet
+    return hash == 0 ? 1 : hash;
+}
+
+StringBuffer* StringBuffer__create(size_t capacity) {
+    StringBuffer* result = linx_malloc(TYPE_STRING, sizeof(StringBuffer));
+    result->length = 0;
+    result->capacity = capacity;
+    result->chars = linx_malloc(TYPE_STRING, capacity + 1);
+    result->chars[0] = '\0';
+    return result;
+}
+
+void StringBuffer__reserve(StringBuffer* buffer, size_t capacity) {
+    if (buffer->capacity >= capacity) return;
+
+    size_t new_capacity = buffer->capacity * 2;
+    if (new_capacity < capacity) new_capacity = capacity;
+
+    char* chars = linx_malloc(TYPE_STRING, new_capacity + 1);
+    memcpy(chars, buffer->chars, buffer->length + 1);
+    buffer->chars = chars;
+    buffer->capacity = new_capacity;
+}
+
+void StringBuffer__append(StringBuffer* buffer, const char* chars,
+                          size_t length) {
+    StringBuffer__reserve(buffer, buffer->length + length);
+    memcpy(buffer->chars + buffer->length, chars, length);
+    buffer->length += length;
+    buffer->chars[buffer->length] = '\0';
+}
+
+void StringBuffer__append_charptr(StringBuffer* buffer, const char* chars) {
+    StringBuffer__append(buffer, chars, strlen(chars));
+}
+
+String* String__from_buffer(StringBuffer* buffer) {
+    String* result = linx_malloc(TYPE_STRING, sizeof(String));
+    result->length = buffer->length;
+    result->hash = 0;
+    result->interned = false;
+    result->buffer = buffer;
+    result->chars = buffer->chars;
+    return result;
+}
+
+String* String__create(const char* chars, size_t length) {
+    StringBuffer* buffer = StringBuffer__create(length);
+    StringBuffer__append(buffer, chars, length);
+    return String__from_buffer(buffer);
+}
+
+String* String__append(String* lhs, const char* chars, size_t length) {
+    StringBuffer* buffer = lhs->buffer;
+
+    // other threads might be appending to the same buffer
+    LINX_LOCK(linx_shared_lock);
+    if (buffer != NULL && buffer->chars == lhs->chars &&
+        buffer->length == lhs->length) {
+        // lhs owns the end of its buffer, so append in place
+        StringBuffer__append(buffer, chars, length);
+        String* result = String__from_buffer(buffer);
+        LINX_UNLOCK(linx_shared_lock);
+        return result;
+    }
+    LINX_UNLOCK(linx_shared_lock);
+
+    buffer = StringBuffer__create((lhs->length + length) * 2);
+    StringBuffer__append(buffer, lhs->chars, lhs->length);
+    StringBuffer__append(buffer, chars, length);
+    return String__from_buffer(buffer);
+}
+
+String* String__concat(String* lhs, String* rhs) {
+    return String__append(lhs, rhs->chars, rhs->length);
+}
+
+// returns the contents as a NUL terminated C string
+char* String__to_charptr(String* str) {
+    if (str->chars[str->length] == '\0') return str->chars;
+
+    char* result = linx_malloc(TYPE_STRING, str->length + 1);
+    memcpy(result, str->chars, str->length);
+    result[str->length] = '\0';
+    return result;
+}
+
+size_t String__hash(String* str) {
+    if (str->hash == 0) str->hash = charptr_hash(str->chars, str->length);
+    return str->hash;
+}
+
+bool String__equals(String* lhs, String* rhs) {
+    if (lhs == rhs) return true;
+
+    // equal interned strings are always the same object
+    if (lhs->interned && rhs->interned) return false;
+    if (lhs->length != rhs->length) return false;
+    if (lhs->hash != 0 && rhs->hash != 0 && lhs->hash != rhs->hash) {
+        return false;
+    }
+
+    return memcmp(lhs->chars, rhs->chars, lhs->length) == 0;
+}
+
+// orders strings by their bytes (so by code point), like `strcmp`
+int String__compare(String* lhs, String* rhs) {
+    if (lhs == rhs) return 0;
+
+    size_t length = lhs->length < rhs->length ? lhs->length : rhs->length;
+    int result = memcmp(lhs->chars, rhs->chars, length);
+    if (result != 0) return result;
+    return (lhs->length > rhs->length) - (lhs->length < rhs->length);
+}
+
+/*
+    the intern table. it's an open addressing (linear probing) hash set
+    of strings used for literals & property names. interned strings are
+    reachable from the (root) table, so they live as long as the program.
+*/
+static String** String__interned = NULL;
+static size_t String__interned_capacity = 0;
+static size_t String__interned_length = 0;
+
+void String__interned_insert(String** table, size_t capacity, String* str) {
+    size_t i = str->hash & (capacity - 1);
+    while (table[i] != NULL) i = (i + 1) & (capacity - 1);
+    table[i] = str;
+}
+
+void String__interned_grow() {
+    String** old_table = String__interned;
+    size_t old_capacity = String__interned_capacity;
+
+    String__interned_capacity = old_capacity == 0 ? 256 : old_capacity * 2;
+    String__interned =
+        linx_malloc_root(sizeof(String*) * String__interned_capacity);
+    memset(String__interned, 0, sizeof(String*) * String__interned_capacity);
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_table[i] != NULL) {
+            String__interned_insert(String__interned,
+                                    String__interned_capacity, old_table[i]);
+        }
+    }
+
+    if (old_table != NULL) linx_free(old_table);
+}
+
+static String* String__intern_unlocked(const char* chars, size_t length) {
+    if ((String__interned_length + 1) * 2 > String__interned_capacity) {
+        String__interned_grow();
+    }
+
+    size_t hash = charptr_hash(chars, length);
+    size_t i = hash & (String__interned_capacity - 1);
+
+    while (String__interned[i] != NULL) {
+        String* existing = String__interned[i];
+        if (existing->hash == hash && existing->length == length &&
+            memcmp(existing->chars, chars, length) == 0) {
+            return existing;
+        }
+        i = (i + 1) & (String__interned_capacity - 1);
+    }
+
+    String* result = String__create(chars, length);
+    result->hash = hash;
+    result->interned = true;
+    // interned strings are shared by the whole program, never append to them
+    result->buffer = NULL;
+
+    String__interned[i] = result;
+    String__interned_length++;
+    return result;
+}
+
+String* String__intern(const char* chars, size_t length) {
+    LINX_LOCK(linx_shared_lock);
+    String* result = String__intern_unlocked(chars, length);
+    LINX_UNLOCK(linx_shared_lock);
+    return result;
+}
+
+void Nursery__add_block() {
+    if (nursery.blocks_length == nursery.blocks_capacity) {
+        size_t capacity = nursery.blocks_capacity == 0
+                              ? NURSERY_INITIAL_BLOCKS
+                              : nursery.blocks_capacity * 2;
+        NurseryBlock* blocks =
+            linx_malloc_root(capacity * sizeof(NurseryBlock));
+
+        for (size_t i = 0; i < nursery.blocks_length; i++) {
+            blocks[i] = nursery.blocks[i];
+        }
+
+        if (nursery.blocks != NULL) linx_free(nursery.blocks);
+        nursery.blocks = blocks;
+        nursery.blocks_capacity = capacity;
+    }
+
+    NurseryBlock* block = &nursery.blocks[nursery.blocks_length++];
+    block->values = linx_malloc_root(NURSERY_BLOCK_VALUES * sizeof(Value));
+    memset(block->values, 0, NURSERY_BLOCK_VALUES * sizeof(Value));
+    block->full = false;
+    block->pinned = false;
+
+    char* low = (char*)block->values;
+    char* high = (char*)(block->values + NURSERY_BLOCK_VALUES);
+    if (nursery.low == NULL || low < nursery.low) nursery.low = low;
+    if (nursery.high == NULL || high > nursery.high) nursery.high = high;
+}
+
+// the stack scan reads whole frames, including what asan considers padding
+#if defined(__SANITIZE_ADDRESS__)
+__attribute__((no_sanitize_address))
+#endif
+void Nursery__scan_stack() {
+    void* top;
+    char** start = (char**)&top;
+    char** end = (char**)nursery.stack_bottom;
+
+    // the stack might grow in either direction
+    if (start > end) {
+        char** tmp = start;
+        start = end;
+        end = tmp;
+    }
+
+    for (char** p = start; p < end; p++) {
+        char* ptr = *p;
+        if (ptr < nursery.low || ptr >= nursery.high) continue;
+
+        for (size_t i = 0; i < nursery.blocks_length; i++) {
+            NurseryBlock* block = &nursery.blocks[i];
+            if (ptr >= (char*)block->values &&
+                ptr < (char*)(block->values + NURSERY_BLOCK_VALUES)) {
+                block->pinned = true;
+                break;
+            }
+        }
+    }
+}
+
+void Nursery__collect() {
+    for (size_t i = 0; i < nursery.blocks_length; i++) {
+        nursery.blocks[i].pinned = false;
+    }
+
+    /*
+        spill registers onto the stack so pointers held in them are seen too.
+        glibc's setjmp mangles some of the registers it saves, so gcc & clang
+        are asked to spill every callee saved register as well.
+    */
+    jmp_buf registers;
+    memset(&registers, 0, sizeof(jmp_buf));
+    setjmp(registers);
+#if defined(__GNUC__)
+    __builtin_unwind_init();
+#endif
+
+    // called through a volatile pointer so it can't be inlined in here
+    void (*volatile scan_stack)() = Nursery__scan_stack;
+    scan_stack();
+
+    size_t free_blocks = 0;
+    for (size_t i = 0; i < nursery.blocks_length; i++) {
+        NurseryBlock* block = &nursery.blocks[i];
+        if (block->pinned) continue;
+
+        // clearing the block lets tgc collect whatever its values pointed to
+        memset(block->values, 0, NURSERY_BLOCK_VALUES * sizeof(Value));
+        block->full = false;
+        free_blocks++;
+    }
+
+    // keep some headroom so that pinned blocks don't cause constant collections
+    while (free_blocks < nursery.blocks_length / 4 + 1) {
+        Nursery__add_block();
+        free_blocks++;
+    }
+
+    nursery.collections++;
+}
+
+void Nursery__refill() {
+    if (nursery.end != NULL) {
+        nursery.blocks[nursery.current].full = true;
+        nursery.allocated += NURSERY_BLOCK_VALUES;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        for (size_t i = 0; i < nursery.blocks_length; i++) {
+            if (!nursery.blocks[i].full) {
+                nursery.current = i;
+                nursery.next = nursery.blocks[i].values;
+                nursery.end = nursery.next + NURSERY_BLOCK_VALUES;
+                return;
+            }
+        }
+
+        // the stack can't be scanned before the runtime is started
+        if (nursery.stack_bottom != NULL && nursery.blocks_length > 0) {
+            Nursery__collect();
+        } else {
+            for (int i = 0; i < NURSERY_INITIAL_BLOCKS; i++) {
+                Nursery__add_block();
+            }
+        }
+    }
+}
+
+void Value__copy(Value* lhs, Value* rhs) {
+    PROFILE(profile.copies[rhs->type]++);
+    lhs->type = rhs->type;
+
+    switch (rhs->type) {
+        case TYPE_NIL: {
+            lhs->as.raw = NULL;
+            break;
+        }
+        case TYPE_BOOLEAN: {
+            lhs->as.boolean = rhs->as.boolean;
+            break;
+        }
+        case TYPE_NUMBER: {
+            lhs->as.number = rhs->as.number;
+            break;
+        }
+        case TYPE_STRING: {
+            // strings are immutable so the copy can share them
+            lhs->as.raw = rhs->as.raw;
+            break;
+        }
+        case TYPE_LIST: {
+            /*
+                lists & objects are copy-on-write: the copy shares the
+                payload, which is then only duplicated by the first mutation.
+            */
+            lhs->as.raw = rhs->as.raw;
+            LINX_SHARE((List*)lhs->as.raw);
+            break;
+        }
+        case TYPE_OBJECT: {
+            lhs->as.raw = rhs->as.raw;
+            LINX_SHARE((Object*)lhs->as.raw);
+            break;
+        }
+        case TYPE_FUNCTION: {
+            // closures are never changed after they're created
+            lhs->as.raw = rhs->as.raw;
+            break;
+        }
+    }
+}
+
+Value* Value__from_value(Value* value) {
+    Value* result = Value__alloc();
+    Value__copy(result, value);
+    return result;
+}
+
+// a copy of `value` that lives on the gc heap instead of in the nursery
+Value* Value__create_cell(Value* value) {
+    Value* result = linx_malloc(value->type, sizeof(Value));
+    Value__copy(result, value);
+    return result;
+}
+
+bool Value__equals(Value* lhs, Value* rhs) {
+    if (lhs->type != rhs->type) return false;
+
+    switch (lhs->type) {
+        case TYPE_NIL: {
+            // nil is always equal to nil
+            return true;
+        }
+        case TYPE_BOOLEAN: {
+            return lhs->as.boolean == rhs->as.boolean;
+        }
+        case TYPE_NUMBER: {
+            return lhs->as.number == rhs->as.number;
+        }
+        case TYPE_STRING: {
+            return String__equals((String*)lhs->as.raw, (String*)rhs->as.raw);
+        }
+        case TYPE_LIST: {
+            // copies share their payload until either of them is changed
+            if (lhs->as.raw == rhs->as.raw) return true;
+            if (((List*)lhs->as.raw)->length != ((List*)rhs->as.raw)->length)
+                return false;
+
+            for (size_t i = 0; i < ((List*)lhs->as.raw)->length; i++) {
+                Value lhs_element = List__get((List*)lhs->as.raw, i);
+                Value rhs_element = List__get((List*)rhs->as.raw, i);
+                if (!Value__equals(&lhs_element, &rhs_element)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+        case TYPE_OBJECT: {
+            // objects are equal if they have the same pairs, in any order
+            Object* lhs_object = (Object*)lhs->as.raw;
+            Object* rhs_object = (Object*)rhs->as.raw;
+            if (lhs_object == rhs_object) return true;
+            if (lhs_object->keys->length != rhs_object->keys->length)
+                return false;
+
+            for (size_t i = 0; i < lhs_object->keys->length; i++) {
+                long position =
+                    Object__find(rhs_object, &lhs_object->keys->arr[i]);
+                if (position < 0 ||
+                    !Value__equals(&lhs_object->values->arr[i],
+                                   &rhs_object->values->arr[position])) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+        case TYPE_FUNCTION: {
+            // functions are only equal if they reference the same object
+            return (Function*)lhs->as.raw == (Function*)rhs->as.raw;
+        }
+    }
+}
+
+// spreads the bits of `hash` (the finalizer of splitmix64)
+static size_t hash_mix(unsigned long long hash) {
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return (size_t)(hash ^ (hash >> 31));
+}
+
+/*
+    structural hashes, consistent with `Value__equals`: equal values hash
+    the same even if they don't share a payload.
+*/
+size_t Value__hash(Value* value) {
+    switch (value->type) {
+        case TYPE_NIL:
+            return 0;
+        case TYPE_BOOLEAN:
+            return value->as.boolean ? 1 : 2;
+        case TYPE_NUMBER: {
+            // 0 & -0 are equal, but their bits aren't
+            double number = value->as.number == 0 ? 0 : value->as.number;
+            unsigned long long bits;
+            memcpy(&bits, &number, sizeof(bits));
+            return hash_mix(bits);
+        }
+        case TYPE_STRING:
+            return String__hash((String*)value->as.raw);
+        case TYPE_LIST: {
+            List* list = (List*)value->as.raw;
+            size_t hash = list->length;
+            for (size_t i = 0; i < list->length; i++) {
+                Value element = List__get(list, i);
+                hash = hash_mix(hash * 31 + Value__hash(&element));
+            }
+            return hash;
+        }
+        case TYPE_OBJECT: {
+            // the pairs' hashes are summed, since their order doesn't matter
+            Object* object = (Object*)value->as.raw;
+            size_t hash = object->keys->length;
+            for (size_t i = 0; i < object->keys->length; i++) {
+                hash += hash_mix(Value__hash(&object->keys->arr[i]) * 31 +
+                                 Value__hash(&object->values->arr[i]));
+            }
+            return hash;
+        }
+        case TYPE_FUNCTION:
+            return hash_mix((unsigned long long)(size_t)value->as.raw);
+    }
+
+    return 0;
+}
+
+List* List__create() {
+    List* result = linx_malloc(TYPE_LIST, sizeof(List));
+    result->capacity = 0;
+    result->length = 0;
+    result->arr = NULL;
+    result->shared = false;
+    result->range = false;
+    return result;
+}
+
+// the number of elements from `start` to `end` (inclusive), 0 if they're equal
+size_t Range__length(double start, double end, double step) {
+    if (start == end) return 0;
+
+    double distance = start < end ? end - start : start - end;
+    return (size_t)(distance / step) + 1;
+}
+
+List* List__create_range(double start, double step, size_t length) {
+    List* result = List__create();
+    result->length = length;
+    result->range = true;
+    result->start = start;
+    result->step = step;
+    return result;
+}
+
+// makes sure the list can hold `capacity` elements without growing
+void List__reserve(List* list, size_t capacity) {
+    if (list->capacity >= capacity) return;
+
+    // the elements are plain values, so growing only has to move them
+    list->arr = linx_realloc(TYPE_LIST, list->arr, capacity * sizeof(Value));
+    list->capacity = capacity;
+}
+
+void List__grow(List* list) {
+    // if capacity is not enough for one more element
+    if (list->capacity < list->length + 1) {
+        List__reserve(list, list->capacity < 4 ? 8 : list->capacity * 2);
+    }
+}
+
+void List__append(List* list, Value* value) {
+    List__grow(list);
+    Value__copy(&list->arr[list->length], value);
+    list->length++;
+}
+
+/*
+    appends `length` elements of `other`, from `start` on. the elements are
+    moved over in bulk, copies of lists & objects only differ from the
+    originals in that they're now shared (see `Value__copy`).
+*/
+void List__append_range(List* list, List* other, size_t start,
+                        size_t length) {
+    List__reserve(list, list->length + length);
+    Value* elements = &list->arr[list->length];
+
+    if (other->range) {
+        for (size_t i = 0; i < length; i++) {
+            elements[i] = List__get(other, start + i);
+        }
+    } else if (length > 0) {
+        memcpy(elements, &other->arr[start], sizeof(Value) * length);
+        for (size_t i = 0; i < length; i++) {
+            if (elements[i].type == TYPE_LIST) {
+                LINX_SHARE((List*)elements[i].as.raw);
+            } else if (elements[i].type == TYPE_OBJECT) {
+                LINX_SHARE((Object*)elements[i].as.raw);
+            }
+        }
+    }
+
+    list->length += length;
+}
+
+void List__append_all(List* list, List* other) {
+    List__append_range(list, other, 0, other->length);
+}
+
+// turns a lazy range into a regular list before it gets written to
+void List__materialize(List* list) {
+    if (!list->range) return;
+
+    size_t length = list->length;
+    list->range = false;
+    list->length = 0;
+    List__reserve(list, length);
+
+    for (size_t i = 0; i < length; i++) {
+        list->arr[i].type = TYPE_NUMBER;
+        list->arr[i].as.number = list->start + i * list->step;
+    }
+    list->length = length;
+}
+
+// a shallow copy, nested lists & objects end up shared by both lists
+List* List__clone(List* list) {
+    if (list->range) {
+        return List__create_range(list->start, list->step, list->length);
+    }
+
+    PROFILE(profile.clone_bytes += list->length * sizeof(Value));
+    List* result = List__create();
+    List__append_all(result, list);
+    return result;
+}
+
+Value* Function__call(Function* fn, Value** arguments) {
+    return fn->call(fn->environment, arguments);
+}
+
+/*
+    the first entries of `environment` are captured by reference, the last
+    `values_length` ones (constants, which can't change) are copied into the
+    closure itself so that they don't need a cell of their own.
+*/
+Function* Function__create(fnptr fn, Value** environment,
+                           size_t environment_length, size_t values_length) {
+    size_t size = sizeof(Function) + sizeof(Value*) * environment_length +
+                  sizeof(Value) * values_length;
+    Function* result = linx_malloc(TYPE_FUNCTION, size);
+    result->call = fn;
+    result->environment_length = environment_length;
+
+    size_t references = environment_length - values_length;
+    Value* values = (Value*)&result->environment[environment_length];
+
+    for (size_t i = 0; i < references; i++) {
+        result->environment[i] = environment[i];
+    }
+    for (size_t i = 0; i < values_length; i++) {
+        Value__copy(&values[i], environment[references + i]);
+        result->environment[references + i] = &values[i];
+    }
+
+    return result;
+}
+
+Value* Value__from_string(String* str) {
+    Value* result = Value__alloc();
+    result->type = TYPE_STRING;
+    result->as.raw = str;
+    return result;
+}
+
+Value* Value__from_charptr(const char* str) {
+    return Value__from_string(String__create(str, strlen(str)));
+}
+
+/*
+    returns an immortal value holding an interned string. used for
+    string literals & property names which are created once at startup.
+*/
+Value* Value__intern(const char* str) {
+    Value* result = linx_malloc_root(sizeof(Value));
+    result->type = TYPE_STRING;
+    result->as.raw = String__intern(str, strlen(str));
+    return result;
+}
+
+Value* Value__create_list() {
+    Value* result = Value__alloc();
+    result->type = TYPE_LIST;
+    result->as.raw = List__create();
+    return result;
+}
+
+Value* Value__from_array(Value* arr[], size_t count) {
+    Value* result = Value__create_list();
+    List* list = (List*)result->as.raw;
+
+    List__reserve(list, count);
+    for (size_t i = 0; i < count; i++) {
+        Value__copy(&list->arr[i], arr[i]);
+    }
+    list->length = count;
+
+    return result;
+}
+
+Value* Value__create_fn(fnptr fn, Value** environment,
+                        size_t environment_length, size_t values_length) {
+    Value* result = Value__alloc();
+    result->type = TYPE_FUNCTION;
+    result->as.raw = Function__create(fn, environment, environment_length,
+                                  values_length);
+    return result;
+}
+
+Shape* Shape__create(Shape* parent, Value* key) {
+    // shapes are shared by every object & are never collected
+    Shape* result = linx_malloc_root(sizeof(Shape));
+    result->parent = parent;
+    result->key = key == NULL ? NULL : Value__create_cell(key);
+    result->length = parent == NULL ? 0 : parent->length + 1;
+    result->transitions = NULL;
+    result->transitions_length = 0;
+    result->transitions_capacity = 0;
+    return result;
+}
+
+static Shape* Shape__root = NULL;
+
+Shape* Shape__empty() {
+    if (Shape__root == NULL) Shape__root = Shape__create(NULL, NULL);
+    return Shape__root;
+}
+
+static Shape* Shape__transition_unlocked(Shape* shape, Value* key) {
+    for (size_t i = 0; i < shape->transitions_length; i++) {
+        if (Value__equals(shape->transitions[i]->key, key)) {
+            return shape->transitions[i];
+        }
+    }
+
+    if (shape->length + 1 > SHAPE_MAX_KEYS ||
+        shape->transitions_length >= SHAPE_MAX_TRANSITIONS) {
+        return NULL;
+    }
+
+    if (shape->transitions_length == shape->transitions_capacity) {
+        Shape** old_transitions = shape->transitions;
+
+        shape->transitions_capacity =
+            shape->transitions_capacity == 0 ? 2
+                                             : shape->transitions_capacity * 2;
+        shape->transitions = linx_malloc_root(sizeof(Shape*) *
+                                              shape->transitions_capacity);
+        for (size_t i = 0; i < shape->transitions_length; i++) {
+            shape->transitions[i] = old_transitions[i];
+        }
+    }
+
+    Shape* result = Shape__create(shape, key);
+    shape->transitions[shape->transitions_length++] = result;
+    return result;
+}
+
+// returns `NULL` when the shape tree refuses to grow any further
+Shape* Shape__transition(Shape* shape, Value* key) {
+    LINX_LOCK(linx_shared_lock);
+    Shape* result = Shape__transition_unlocked(shape, key);
+    LINX_UNLOCK(linx_shared_lock);
+    return result;
+}
+
+Object* Object__create() {
+    Object* result = linx_malloc(TYPE_OBJECT, sizeof(Object));
+    result->keys = List__create();
+    result->values = List__create();
+    result->shape = Shape__empty();
+    result->index = NULL;
+    result->index_capacity = 0;
+    result->shared = false;
+    return result;
+}
+
+Object* Object__clone(Object* object) {
+    Object* result = linx_malloc(TYPE_OBJECT, sizeof(Object));
+    result->keys = List__clone(object->keys);
+    result->values = List__clone(object->values);
+    result->shape = object->shape;
+    result->index_capacity = object->index_capacity;
+    result->index = NULL;
+    result->shared = false;
+
+    if (object->index != NULL) {
+        size_t index_size = sizeof(size_t) * object->index_capacity;
+        result->index = linx_malloc(TYPE_OBJECT, index_size);
+        memcpy(result->index, object->index, index_size);
+    }
+
+    return result;
+}
+
+/*
+    the copy-on-write mutation path: if the payload is shared with other
+    values, `value` gets its own copy before anything is written to it.
+*/
+List* Value__mutable_list(Value* value) {
+    if (LINX_SHARED((List*)value->as.raw)) {
+        PROFILE(profile.clones++);
+        value->as.raw = List__clone((List*)value->as.raw);
+    }
+    List__materialize((List*)value->as.raw);
+    return (List*)value->as.raw;
+}
+
+Object* Value__mutable_object(Value* value) {
+    if (LINX_SHARED((Object*)value->as.raw)) {
+        PROFILE(profile.clones++);
+        value->as.raw = Object__clone((Object*)value->as.raw);
+    }
+    return (Object*)value->as.raw;
+}
+
+void Object__index_insert(Object* object, size_t position) {
+    size_t mask = object->index_capacity - 1;
+    size_t i = Value__hash(&object->keys->arr[position]) & mask;
+
+    while (object->index[i] != 0) i = (i + 1) & mask;
+    object->index[i] = position + 1;
+}
+
+// (re)builds the hash index so that it stays at most half full
+void Object__reindex(Object* object) {
+    size_t capacity = 16;
+    while (capacity < object->keys->length * 2) capacity *= 2;
+
+    object->index_capacity = capacity;
+    object->index = linx_malloc(TYPE_OBJECT, sizeof(size_t) * capacity);
+    memset(object->index, 0, sizeof(size_t) * capacity);
+
+    for (size_t i = 0; i < object->keys->length; i++) {
+        Object__index_insert(object, i);
+    }
+}
+
+#ifdef LINX_PROFILE
+void Profile__probes(size_t probes) {
+    if (probes >= PROFILE_PROBE_BUCKETS) probes = PROFILE_PROBE_BUCKETS - 1;
+    profile.probes[probes]++;
+}
+#endif
+
+// returns the position of `key` in the object, or -1 if it doesn't exist
+long Object__find(Object* object, Value* key) {
+    if (object->index != NULL) {
+        size_t mask = object->index_capacity - 1;
+        size_t i = Value__hash(key) & mask;
+        PROFILE(size_t probes = 0);
+
+        while (object->index[i] != 0) {
+            size_t position = object->index[i] - 1;
+            PROFILE(probes++);
+            if (Value__equals(&object->keys->arr[position], key)) {
+                PROFILE(Profile__probes(probes));
+                return (long)position;
+            }
+            i = (i + 1) & mask;
+        }
+
+        PROFILE(Profile__probes(probes));
+        return -1;
+    }
+
+    for (size_t i = 0; i < object->keys->length; i++) {
+        if (Value__equals(&object->keys->arr[i], key)) {
+            PROFILE(Profile__probes(i + 1));
+            return (long)i;
+        }
+    }
+
+    PROFILE(Profile__probes(object->keys->length));
+    return -1;
+}
+
+Value* Value__create_object() {
+    Value* result = Value__alloc();
+    result->type = TYPE_OBJECT;
+    result->as.raw = Object__create();
+    return result;
+}
+
+Value* Object__get(Object* object, Value* key) {
+    long position = Object__find(object, key);
+    if (position >= 0) return &object->values->arr[position];
+
+    // returns `nil` if key doesn't exist
+    return Value__create_nil();
+}
+
+// adds a key the object doesn't have yet
+static void Object__add(Object* object, Value* key, Value* value) {
+    List__append(object->keys, key);
+    List__append(object->values, value);
+
+    if (object->shape != NULL) {
+        object->shape = Shape__transition(object->shape, key);
+    }
+
+    if (object->index != NULL &&
+        object->keys->length * 2 <= object->index_capacity) {
+        Object__index_insert(object, object->keys->length - 1);
+    } else if (object->keys->length >= OBJECT_INDEX_THRESHOLD) {
+        Object__reindex(object);
+    }
+}
+
+void Object__set(Object* object, Value* key, Value* value) {
+    long position = Object__find(object, key);
+
+    // if the object has the key, only its value has to be updated
+    if (position >= 0) {
+        Value__copy(&object->values->arr[position], value);
+        return;
+    }
+
+    // otherwise the key has to be added
+    Object__add(object, key, value);
+}
+
+// the slot of the index that holds `position`
+static size_t Object__index_slot(Object* object, size_t position) {
+    size_t mask = object->index_capacity - 1;
+    size_t i = Value__hash(&object->keys->arr[position]) & mask;
+
+    while (object->index[i] != position + 1) i = (i + 1) & mask;
+    return i;
+}
+
+/*
+    removes `key` (if it's there) by moving the last pair into its place,
+    so that nothing else moves. the object leaves the shape tree since its
+    keys are out of order. the index is fixed up by shifting the entries
+    after the removed one back towards their home slots, linear probing
+    can't have gaps in between an entry & its home.
+*/
+bool Object__remove(Object* object, Value* key) {
+    long position = Object__find(object, key);
+    if (position < 0) return false;
+
+    size_t last = object->keys->length - 1;
+    size_t hole = 0, moved = 0;
+    if (object->index != NULL) {
+        hole = Object__index_slot(object, (size_t)position);
+        moved = Object__index_slot(object, last);
+    }
+
+    object->keys->arr[position] = object->keys->arr[last];
+    object->values->arr[position] = object->values->arr[last];
+    object->keys->length--;
+    object->values->length--;
+    object->shape = NULL;
+
+    if (object->index == NULL) return true;
+    if (moved != hole) object->index[moved] = position + 1;
+
+    size_t mask = object->index_capacity - 1;
+    for (size_t i = (hole + 1) & mask; object->index[i] != 0;
+         i = (i + 1) & mask) {
+        size_t home =
+            Value__hash(&object->keys->arr[object->index[i] - 1]) & mask;
+
+        // entries whose home is in between the hole & them stay put
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            object->index[hole] = object->index[i];
+            hole = i;
+        }
+    }
+    object->index[hole] = 0;
+
+    return true;
+}
+
+Value* Value__create_object_from_arrs(Value** keys, Value** values,
+                                      size_t size) {
+    Value* result = Value__alloc();
+    result->type = TYPE_OBJECT;
+    result->as.raw = Object__create();
+
+    for (size_t i = 0; i < size; i++) {
+        Object__set((Object*)result->as.raw, keys[i], values[i]);
+    }
+
+    return result;
+}
+
+// appends the string representation of `value` to `buffer`
+void StringBuffer__append_value(StringBuffer* buffer, Value* value) {
+    switch (value->type) {
+        case TYPE_NIL:
+            StringBuffer__append(buffer, "nil", 3);
+            break;
+        case TYPE_BOOLEAN:
+            StringBuffer__append_charptr(buffer,
+                                         value->as.boolean ? "true" : "false");
+            break;
+        case TYPE_NUMBER: {
+            char number[32];
+            double n = value->as.number;
+
+            /*
+                small integers are written directly, they're printed the
+                same way by `%g` (which only switches to an exponent from
+                a million on) & are by far the most common numbers.
+            */
+            if (n > -1e6 && n < 1e6 && n == (long)n &&
+                !(n == 0 && signbit(n))) {
+                long digits = n < 0 ? -(long)n : (long)n;
+                int length = 0;
+                char reversed[8];
+                do {
+                    reversed[length++] = '0' + digits % 10;
+                    digits /= 10;
+                } while (digits != 0);
+
+                int start = 0;
+                if (n < 0) number[start++] = '-';
+                for (int i = 0; i < length; i++) {
+                    number[start + i] = reversed[length - 1 - i];
+                }
+                StringBuffer__append(buffer, number, start + length);
+                break;
+            }
+
+            int length = snprintf(number, sizeof(number), "%g", n);
+            StringBuffer__append(buffer, number, length);
+            break;
+        }
+        case TYPE_STRING:
+            StringBuffer__append(buffer, ((String*)value->as.raw)->chars,
+                                 ((String*)value->as.raw)->length);
+            break;
+        case TYPE_LIST: {
+            List* list = (List*)value->as.raw;
+
+            StringBuffer__append(buffer, "[", 1);
+            for (size_t i = 0; i < list->length; i++) {
+                Value element = List__get(list, i);
+                StringBuffer__append_value(buffer, &element);
+                if (i != list->length - 1) {
+                    StringBuffer__append(buffer, ", ", 2);
+                }
+            }
+            StringBuffer__append(buffer, "]", 1);
+            break;
+        }
+        case TYPE_OBJECT: {
+            List* keys = ((Object*)value->as.raw)->keys;
+            List* values = ((Object*)value->as.raw)->values;
+
+            StringBuffer__append(buffer, "{", 1);
+            for (size_t i = 0; i < keys->length; i++) {
+                StringBuffer__append_value(buffer, &keys->arr[i]);
+                StringBuffer__append(buffer, ": ", 2);
+                StringBuffer__append_value(buffer, &values->arr[i]);
+                if (i != keys->length - 1) {
+                    StringBuffer__append(buffer, ", ", 2);
+                }
+            }
+            StringBuffer__append(buffer, "}", 1);
+            break;
+        }
+        case TYPE_FUNCTION:
+            StringBuffer__append(buffer, "<function>", 10);
+            break;
+    }
+}
+
+char* Value__to_charptr(Value* value) {
+    switch (value->type) {
+        case TYPE_NIL:
+            return "nil";
+        case TYPE_BOOLEAN:
+            return value->as.boolean ? "true" : "false";
+        case TYPE_NUMBER:
+            return double_to_charptr(value->as.number);
+        case TYPE_STRING:
+            return String__to_charptr((String*)value->as.raw);
+        case TYPE_LIST:
+        case TYPE_OBJECT: {
+            StringBuffer* buffer = StringBuffer__create(64);
+            StringBuffer__append_value(buffer, value);
+            return buffer->chars;
+        }
+        case TYPE_FUNCTION:
+            return "<function>";
+    }
+}
+
+String* Value__to_string(Value* value) {
+    if (value->type == TYPE_STRING) return (String*)value->as.raw;
+
+    StringBuffer* buffer = StringBuffer__create(16);
+    StringBuffer__append_value(buffer, value);
+    return String__from_buffer(buffer);
+}
+
+/*
+    the output of `print`. values are serialized straight into one big
+    buffer instead of into a string per value, & the buffer is only written
+    to stdout when it fills up (& when the program exits). its size in bytes
+    can be set with `LINX_OUTPUT_BUFFER`, 0 writes out every line.
+*/
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+static StringBuffer* output = NULL;
+static size_t output_size = OUTPUT_BUFFER_SIZE;
+
+void Output__start() {
+    const char* size = getenv("LINX_OUTPUT_BUFFER");
+    if (size != NULL) output_size = (size_t)atol(size);
+
+    // a root, so tgc keeps the buffer (& whatever it grows into) alive
+    output = linx_malloc_root(sizeof(StringBuffer));
+    output->length = 0;
+    output->capacity = output_size;
+    output->chars = linx_malloc_root(output_size + 1);
+    output->chars[0] = '\0';
+}
+
+void Output__flush() {
+    if (output == NULL || output->length == 0) return;
+
+    fwrite(output->chars, 1, output->length, stdout);
+    fflush(stdout);
+    output->length = 0;
+}
+
+void print(Value* value) {
+    // `parallel.map` might be printing from other threads
+    LINX_LOCK(linx_shared_lock);
+    StringBuffer__append_value(output, value);
+    StringBuffer__append(output, "\n", 1);
+    if (output->length >= output_size) Output__flush();
+    LINX_UNLOCK(linx_shared_lock);
+}
+
+/*
+    *-----------------*
+    |    Operators    |
+    *-----------------*
+*/
+
+/* <-- Logical --> */
+
+// lhs && rhs
+Value* linx__operator_or(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    return Value__from_bool(Value__to_bool(lhs) || Value__to_bool(rhs));
+}
+// lhs || rhs
+Value* linx__operator_and(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    return Value__from_bool(Value__to_bool(lhs) && Value__to_bool(rhs));
+}
+// !value
+Value* linx__operator_not(Value* value) {
+    PROFILE_CALL();
+    return Value__from_bool(!Value__to_bool(value));
+}
+
+/* <-- Comparisons --> */
+
+// lhs == rhs
+Value* linx__operator_equals(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    return Value__from_bool(Value__equals(lhs, rhs));
+}
+// lhs != rhs
+Value* linx__operator_nequals(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    return Value__from_bool(!Value__equals(lhs, rhs));
+}
+// lhs < rhs
+Value* linx__operator_lesser(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    bool result = false;
+    /*
+        is `[1, 2, 3] < 45`?
+
+        might revisit this, but for comparisons between values
+        of different types the result is always false
+    */
+    if (lhs->type != rhs->type) return Value__from_bool(false);
+
+    switch (lhs->type) {
+        case TYPE_NIL:
+            result = false;
+            break;
+        case TYPE_BOOLEAN:
+            // false is less than true
+            result = lhs->as.boolean < rhs->as.boolean;
+            break;
+        case TYPE_NUMBER:
+            result = lhs->as.number < rhs->as.number;
+            break;
+        case TYPE_STRING:
+            result = String__compare((String*)lhs->as.raw,
+                                     (String*)rhs->as.raw) < 0;
+            break;
+        case TYPE_LIST:
+            result =
+                ((List*)lhs->as.raw)->length < ((List*)rhs->as.raw)->length;
+            break;
+        case TYPE_OBJECT:
+            result = ((Object*)lhs->as.raw)->keys->length <
+                     ((Object*)rhs->as.raw)->keys->length;
+            break;
+        case TYPE_FUNCTION:
+            result = false;
+            break;
+    }
+
+    return Value__from_bool(result);
+}
+// lhs > rhs
+Value* linx__operator_greater(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    return linx__operator_lesser(rhs, lhs);
+}
+// lhs <= rhs
+Value* linx__operator_lequals(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    return linx__operator_or(linx__operator_lesser(lhs, rhs),
+                             linx__operator_equals(lhs, rhs));
+}
+// lhs >= rhs
+Value* linx__operator_gequals(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    return linx__operator_or(linx__operator_greater(lhs, rhs),
+                             linx__operator_equals(lhs, rhs));
+}
+
+/* <-- Arithmetic --> */
+
+// lhs + rhs
+Value* linx__operator_add(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    if (lhs->type == TYPE_STRING || rhs->type == TYPE_STRING) {
+        // implicitly convert to string when dealing with addition to strings
+        String* result = Value__to_string(lhs);
+
+        if (rhs->type == TYPE_STRING) {
+            result = String__concat(result, (String*)rhs->as.raw);
+        } else {
+            char* chars = Value__to_charptr(rhs);
+            result = String__append(result, chars, strlen(chars));
+        }
+
+        return Value__from_string(result);
+    } else if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
+        Value* result =
+            Value__from_double(lhs->as.number + rhs->as.number);
+        return result;
+    } else {
+        return Value__create_nil();
+    }
+}
+// lhs - rhs
+Value* linx__operator_subtract(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
+        Value* result =
+            Value__from_double(lhs->as.number - rhs->as.number);
+        return result;
+    } else {
+        return Value__create_nil();
+    }
+}
+// lhs * rhs
+Value* linx__operator_multiply(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
+        Value* result =
+            Value__from_double(lhs->as.number * rhs->as.number);
+        return result;
+    } else if (lhs->type == TYPE_STRING && rhs->type == TYPE_NUMBER &&
+               rhs->as.number > 0) {
+        String* str = (String*)lhs->as.raw;
+        size_t count = (size_t)rhs->as.number;
+
+        StringBuffer* buffer = StringBuffer__create(str->length * count);
+        for (size_t i = 0; i < count; i++) {
+            StringBuffer__append(buffer, str->chars, str->length);
+        }
+        return Value__from_string(String__from_buffer(buffer));
+    } else {
+        return Value__create_nil();
+    }
+}
+// lhs / rhs
+Value* linx__operator_divide(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
+        Value* result =
+            Value__from_double(lhs->as.number / rhs->as.number);
+        return result;
+    } else {
+        return Value__create_nil();
+    }
+}
+// lhs % rhs
+Value* linx__operator_mod(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
+        Value* result = Value__from_double((long)lhs->as.number %
+                                           (long)rhs->as.number);
+        return result;
+    } else {
+        return Value__create_nil();
+    }
+}
+// -value
+Value* linx__operator_negate(Value* value) {
+    PROFILE_CALL();
+    if (value->type == TYPE_NUMBER) {
+        return Value__from_double(-value->as.number);
+    } else {
+        return Value__create_nil();
+    }
+}
+
+/* <-- Other --> */
+
+// lhs = rhs
+Value* linx__operator_assign(Value* lhs, Value* rhs) {
+    PROFILE_CALL();
+    Value__copy(lhs, rhs);
+    return lhs;
+}
+
+// obj.key
+Value* linx__operator_dot(Value* obj, Value* key) {
+    PROFILE_CALL();
+    if (obj->type != TYPE_OBJECT) return Value__create_nil();
+
+    long position = Object__find((Object*)obj->as.raw, key);
+    if (position < 0) return Value__create_nil();
+    return Value__from_value(&((Object*)obj->as.raw)->values->arr[position]);
+}
+
+/*
+    obj.key with a per call site cache. as long as the objects seen by
+    the call site keep the same shape, the key's slot is read directly.
+*/
+Value* linx__operator_dot_cached(Value* obj, Value* key, InlineCache* cache) {
+    PROFILE_CALL();
+    if (obj->type != TYPE_OBJECT) return Value__create_nil();
+
+    Object* object = (Object*)obj->as.raw;
+    if (object->shape != NULL && object->shape == cache->shape) {
+        PROFILE(profile.cache_hits++);
+        return Value__from_value(&object->values->arr[cache->slot]);
+    }
+    PROFILE(profile.cache_misses++);
+
+    long position = Object__find(object, key);
+    if (position < 0) return Value__create_nil();
+
+    // caches are shared by every thread, so only the main thread fills them
+    if (object->shape != NULL && !linx_threads_active) {
+        cache->shape = object->shape;
+        cache->slot = (size_t)position;
+    }
+
+    return Value__from_value(&object->values->arr[position]);
+}
+
+// arr[idx]
+Value* linx__operator_subscript(Value* arr, Value* idx) {
+    PROFILE_CALL();
+    if (arr->type != TYPE_OBJECT && arr->type != TYPE_LIST &&
+        arr->type != TYPE_STRING) {
+        return Value__create_nil();
+    }
+
+    if (arr->type == TYPE_OBJECT) {
+        if (idx->type != TYPE_STRING) return Value__create_nil();
+        return linx__operator_dot(arr, idx);
+    } else {
+        if (idx->type != TYPE_NUMBER) return Value__create_nil();
+
+        // dealing with a list or string & a number idx
+        double index = idx->as.number;
+        size_t length = arr->type == TYPE_LIST
+                            ? ((List*)arr->as.raw)->length
+                            : ((String*)arr->as.raw)->length;
+
+        // TODO: circular indexing would be nice
+        if (index < 0 || index >= length || (int)index != index) {
+            return Value__create_nil();
+        }
+
+        if (arr->type == TYPE_LIST) {
+            Value element = List__get((List*)arr->as.raw, (size_t)index);
+            return Value__from_value(&element);
+        } else {
+            return Value__from_string(
+                String__create(((String*)arr->as.raw)->chars + (int)index, 1));
+        }
+    }
+}
+
+/*
+    assignment targets. `_mut` variants are used for the containers along
+    an assignment path (the `a.b` in `a.b[0] = x`) & give each container
+    along the way its own copy before returning the slot that's written to.
+*/
+
+// obj.key (as part of an assignment target)
+Value* linx__operator_dot_mut(Value* obj, Value* key) {
+    PROFILE_CALL();
+    if (obj->type != TYPE_OBJECT) return Value__create_nil();
+    return Object__get(Value__mutable_object(obj), key);
+}
+
+// arr[idx] (as part of an assignment target)
+Value* linx__operator_subscript_mut(Value* arr, Value* idx) {
+    PROFILE_CALL();
+    if (arr->type == TYPE_OBJECT) {
+        if (idx->type != TYPE_STRING) return Value__create_nil();
+        return linx__operator_dot_mut(arr, idx);
+    }
+
+    if (arr->type != TYPE_LIST || idx->type != TYPE_NUMBER) {
+        return Value__create_nil();
+    }
+
+    double index = idx->as.number;
+    if (index < 0 || index >= ((List*)arr->as.raw)->length ||
+        (int)index != index) {
+        return Value__create_nil();
+    }
+
+    return &Value__mutable_list(arr)->arr[(int)index];
+}
+
+// obj.key = value
+Value* linx__operator_dot_assign(Value* obj, Value* key, Value* value) {
+    PROFILE_CALL();
+    if (obj->type == TYPE_OBJECT) {
+        Object__set(Value__mutable_object(obj), key, value);
+    }
+    return value;
+}
+
+// arr[idx] = value
+Value* linx__operator_subscript_assign(Value* arr, Value* idx, Value* value) {
+    PROFILE_CALL();
+    if (arr->type == TYPE_OBJECT && idx->type == TYPE_STRING) {
+        return linx__operator_dot_assign(arr, idx, value);
+    }
+
+    // invalid targets return the shared `nil`, which mustn't be written to
+    Value* slot = linx__operator_subscript_mut(arr, idx);
+    if (slot != &linx_nil) Value__copy(slot, value);
+    return value;
+}
+
+/* func(...args) */
+Value* linx__operator_call(Value* func, Value** args) {
+    PROFILE_CALL();
+    if (func->type == TYPE_FUNCTION) {
+        return Function__call((Function*)func->as.raw, args);
+    }
+
+    return Value__create_nil();
+}
+
+char* type_to_string(Type t) {
+    switch (t) {
+        case TYPE_NIL:
+            return "nil";
+        case TYPE_BOOLEAN:
+            return "boolean";
+        case TYPE_NUMBER:
+            return "number";
+        case TYPE_STRING:
+            return "string";
+        case TYPE_LIST:
+            return "list";
+        case TYPE_OBJECT:
+            return "object";
+        case TYPE_FUNCTION:
+            return "function";
+    }
+}
+
+Value* len__builtin_def(Value** environment, Value** arguments) {
+    switch (arguments[0]->type) {
+        case TYPE_NIL:
+        case TYPE_BOOLEAN:
+        case TYPE_NUMBER:
+        case TYPE_FUNCTION:
+            return Value__create_nil();
+        case TYPE_STRING:
+            return Value__from_double(
+                ((String*)arguments[0]->as.raw)->length);
+        case TYPE_LIST:
+            return Value__from_double(((List*)arguments[0]->as.raw)->length);
+        case TYPE_OBJECT:
+            return Value__from_double(
+                ((Object*)arguments[0]->as.raw)->keys->length);
+    }
+}
+
+Value* type__builtin_def(Value** environment, Value** arguments) {
+    char* name = type_to_string(arguments[0]->type);
+    return Value__from_string(String__intern(name, strlen(name)));
+}
+
+Value* range__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_NUMBER ||
+        arguments[1]->type != TYPE_NUMBER ||
+        arguments[2]->type != TYPE_NUMBER || arguments[2]->as.number <= 0) {
+        return Value__create_nil();
+    }
+
+    double start = arguments[0]->as.number;
+    double end = arguments[1]->as.number;
+    double step = arguments[2]->as.number;
+
+    // the elements are only computed if the list is written to
+    Value* result = Value__alloc();
+    result->type = TYPE_LIST;
+    result->as.raw =
+        List__create_range(start, start < end ? step : -step,
+                           Range__length(start, end, step));
+    return result;
+}
+
+Value* toString__builtin_def(Value** environment, Value** arguments) {
+    return Value__from_string(Value__to_string(arguments[0]));
+}
+
+Value* print__builtin_def(Value** environment, Value** arguments) {
+    print(arguments[0]);
+    return Value__create_nil();
+}
+
+Value* keys__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type == TYPE_OBJECT) {
+        Value* result = Value__create_list();
+        List__append_all((List*)result->as.raw,
+                         ((Object*)arguments[0]->as.raw)->keys);
+        return result;
+    }
+
+    return Value__create_nil();
+}
+
+/*
+    iterator objects: objects with `valid()` & `next()` functions, like the
+    ones `iterator` & `fs.lines` return. `for` loops (& `iterator`) go
+    through them by calling those instead of iterating their pairs. the
+    keys are interned at startup, so threads don't race to intern them.
+*/
+static Value* iterator_valid_key;
+static Value* iterator_next_key;
+
+// the function `key` of an iterator object, `NULL` if it isn't one
+static Value* Iterator__method(Object* object, Value* key) {
+    long position = Object__find(object, key);
+    if (position < 0) return NULL;
+
+    Value* method = &object->values->arr[position];
+    return method->type == TYPE_FUNCTION ? method : NULL;
+}
+
+static bool Iterator__is_object(Value* value) {
+    return value->type == TYPE_OBJECT &&
+           Iterator__method((Object*)value->as.raw, iterator_valid_key) &&
+           Iterator__method((Object*)value->as.raw, iterator_next_key);
+}
+
+// the iterator closures' constant pool, like the compiler generates
+static Value iterator__one = {.type = TYPE_NUMBER, .as.number = 1.0};
+
+static Value* valid4__linx_definition(Value** environment,
+                                     Value** arguments) {
+    return linx__operator_lequals(
+        environment[0],
+        linx__operator_subtract(
+            len__builtin_def(NULL, (Value*[]){environment[1]}),
+            &iterator__one));
+}
+
+static Value* next3__linx_definition(Value** environment,
+                                     Value** arguments) {
+    Value__copy(environment[0],
+                linx__operator_add(environment[0], &iterator__one));
+    return linx__operator_subscript(
+        environment[1],
+        linx__operator_subtract(environment[0], &iterator__one));
+}
+
+static Value* valid2__linx_definition(Value** environment,
+                                     Value** arguments) {
+    return linx__operator_lequals(
+        environment[0],
+        linx__operator_subtract(
+            len__builtin_def(NULL, (Value*[]){environment[1]}),
+            &iterator__one));
+}
+
+static Value* next1__linx_definition(Value** environment,
+                                     Value** arguments) {
+    Value__copy(environment[0],
+                linx__operator_add(environment[0], &iterator__one));
+
+    return Value__from_array(
+        (Value*[]){
+            linx__operator_subscript(
+                environment[1],
+                linx__operator_subtract(environment[0], &iterator__one)),
+            linx__operator_subscript(
+                environment[2],
+                linx__operator_subscript(
+                    environment[1],
+                    linx__operator_subtract(environment[0], &iterator__one)))},
+        2);
+}
+
+Value* iterator__builtin_def(Value** environment, Value** arguments) {
+    // an iterator object already is one
+    Value* value = arguments[0];
+    if (Iterator__is_object(value)) return value;
+
+    /*
+        the index is shared by both closures & has to outlive this call, the
+        value & its keys never change so they're copied into the closures.
+    */
+    if (value->type == TYPE_OBJECT) {
+        Value* index = Value__create_cell(Value__from_double(0));
+        Value* objKeys = keys__builtin_def(NULL, (Value*[]){value});
+        Value* next = Value__create_fn(&next1__linx_definition,
+                                       (Value*[]){index, objKeys, value}, 3, 2);
+        Value* valid = Value__create_fn(&valid2__linx_definition,
+                                        (Value*[]){index, value}, 2, 1);
+        return Value__create_object_from_arrs(
+            (Value*[]){iterator_next_key, iterator_valid_key},
+            (Value*[]){next, valid}, 2);
+    }
+    if (value->type == TYPE_LIST || value->type == TYPE_STRING) {
+        Value* index = Value__create_cell(Value__from_double(0));
+        Value* next = Value__create_fn(&next3__linx_definition,
+                                       (Value*[]){index, value}, 2, 1);
+        Value* valid = Value__create_fn(&valid4__linx_definition,
+                                        (Value*[]){index, value}, 2, 1);
+        return Value__create_object_from_arrs(
+            (Value*[]){iterator_next_key, iterator_valid_key},
+            (Value*[]){next, valid}, 2);
+    }
+
+    return Value__create_nil();
+}
+
+/*
+    `set(list)` & `map(object)`, hash tables that take any value as a key.
+    the table is an object in dictionary mode (keys that aren't strings
+    shouldn't grow the shape tree) in a cell that every closure of the set
+    or map shares. keys are found by `Value__hash` & `Value__equals`, so
+    lists & objects are compared by what's in them.
+*/
+static Value* Table__create(size_t capacity) {
+    Object* object = Object__create();
+    object->shape = NULL;
+    List__reserve(object->keys, capacity);
+    List__reserve(object->values, capacity);
+
+    // not `Value__create_cell`, copying the object would mark it shared
+    Value* table = linx_malloc(TYPE_OBJECT, sizeof(Value));
+    table->type = TYPE_OBJECT;
+    table->as.raw = object;
+    return table;
+}
+
+static Object* Table__get(Value** environment) {
+    return (Object*)environment[0]->as.raw;
+}
+
+// adds `key` if it isn't in the table yet, returns whether it was added
+static bool Table__add(Object* table, Value* key, Value* value) {
+    if (Object__find(table, key) >= 0) return false;
+    Object__add(table, key, value);
+    return true;
+}
+
+static Value* table_has__linx_definition(Value** environment,
+                                         Value** arguments) {
+    return Value__from_bool(Object__find(Table__get(environment),
+                                         arguments[0]) >= 0);
+}
+
+static Value* table_remove__linx_definition(Value** environment,
+                                            Value** arguments) {
+    return Value__from_bool(
+        Object__remove(Table__get(environment), arguments[0]));
+}
+
+static Value* table_size__linx_definition(Value** environment,
+                                          Value** arguments) {
+    return Value__from_double((double)Table__get(environment)->keys->length);
+}
+
+static Value* table_keys__linx_definition(Value** environment,
+                                          Value** arguments) {
+    Value* result = Value__create_list();
+    List__append_all((List*)result->as.raw, Table__get(environment)->keys);
+    return result;
+}
+
+static Value* table_values__linx_definition(Value** environment,
+                                            Value** arguments) {
+    Value* result = Value__create_list();
+    List__append_all((List*)result->as.raw, Table__get(environment)->values);
+    return result;
+}
+
+static Value* set_add__linx_definition(Value** environment,
+                                       Value** arguments) {
+    return Value__from_bool(
+        Table__add(Table__get(environment), arguments[0], &linx_true));
+}
+
+static Value* map_get__linx_definition(Value** environment,
+                                       Value** arguments) {
+    Object* table = Table__get(environment);
+    long position = Object__find(table, arguments[0]);
+    if (position < 0) return Value__create_nil();
+    return Value__from_value(&table->values->arr[position]);
+}
+
+static Value* map_set__linx_definition(Value** environment,
+                                       Value** arguments) {
+    Object__set(Table__get(environment), arguments[0], arguments[1]);
+    return arguments[1];
+}
+
+// the object of a set's or map's closures over `table`
+static Value* Table__object(Value* table, const char** names, fnptr* fns,
+                            Value** keys, size_t length) {
+    Value* values[length];
+    for (size_t i = 0; i < length; i++) {
+        if (keys[i] == NULL) keys[i] = Value__intern(names[i]);
+        values[i] = Value__create_fn(fns[i], (Value*[]){table}, 1, 0);
+    }
+
+    return Value__create_object_from_arrs(keys, values, length);
+}
+
+/*
+    set(list), a set of the list's elements: an object with `add(value)`
+    (whether the value wasn't in the set yet), `has(value)`,
+    `remove(value)`, `size()` & `values()`. the elements are the keys of
+    its table.
+*/
+Value* set__builtin_def(Value** environment, Value** arguments) {
+    static Value* keys[5] = {NULL};
+    if (arguments[0]->type != TYPE_LIST) return Value__create_nil();
+
+    List* list = (List*)arguments[0]->as.raw;
+    Value* table = Table__create(list->length);
+    for (size_t i = 0; i < list->length; i++) {
+        Value element = List__get(list, i);
+        Table__add((Object*)table->as.raw, &element, &linx_true);
+    }
+
+    return Table__object(
+        table, (const char*[]){"add", "has", "remove", "size", "values"},
+        (fnptr[]){&set_add__linx_definition, &table_has__linx_definition,
+                  &table_remove__linx_definition, &table_size__linx_definition,
+                  &table_keys__linx_definition},
+        keys, 5);
+}
+
+/*
+    map(object), a map with the object's pairs: an object with `get(key)`,
+    `set(key, value)`, `has(key)`, `remove(key)`, `size()`, `keys()` &
+    `values()`.
+*/
+Value* map__builtin_def(Value** environment, Value** arguments) {
+    static Value* keys[7] = {NULL};
+    if (arguments[0]->type != TYPE_OBJECT) return Value__create_nil();
+
+    Object* object = (Object*)arguments[0]->as.raw;
+    Value* table = Table__create(object->keys->length);
+    for (size_t i = 0; i < object->keys->length; i++) {
+        Object__add((Object*)table->as.raw, &object->keys->arr[i],
+                    &object->values->arr[i]);
+    }
+
+    return Table__object(
+        table,
+        (const char*[]){"get", "set", "has", "remove", "size", "keys",
+                        "values"},
+        (fnptr[]){&map_get__linx_definition, &map_set__linx_definition,
+                  &table_has__linx_definition, &table_remove__linx_definition,
+                  &table_size__linx_definition, &table_keys__linx_definition,
+                  &table_values__linx_definition},
+        keys, 7);
+}
+
+/*
+    the `lists` builtins work on the elements of a list directly, instead
+    of through an iterator & its closures. `push` & `pop` change the list
+    they're given (the same as assigning to one of its elements would),
+    the rest return a new list (created at its final size) or value.
+*/
+// lists.push(list, value), returns the new length
+Value* lists_push__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST) return Value__create_nil();
+
+    List* list = Value__mutable_list(arguments[0]);
+    List__append(list, arguments[1]);
+    return Value__from_double((double)list->length);
+}
+
+// lists.pop(list), removes & returns the last element
+Value* lists_pop__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST ||
+        ((List*)arguments[0]->as.raw)->length == 0) {
+        return Value__create_nil();
+    }
+
+    List* list = Value__mutable_list(arguments[0]);
+    list->length--;
+    return Value__from_value(&list->arr[list->length]);
+}
+
+Value* lists_concat__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST || arguments[1]->type != TYPE_LIST) {
+        return Value__create_nil();
+    }
+
+    List* lhs = (List*)arguments[0]->as.raw;
+    List* rhs = (List*)arguments[1]->as.raw;
+    Value* result = Value__create_list();
+    List__reserve((List*)result->as.raw, lhs->length + rhs->length);
+    List__append_range((List*)result->as.raw, lhs, 0, lhs->length);
+    List__append_range((List*)result->as.raw, rhs, 0, rhs->length);
+    return result;
+}
+
+/*
+    lists.slice(list, start, end), the elements from `start` up to (but not
+    including) `end`. indices past either end of the list are clamped.
+*/
+Value* lists_slice__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST || arguments[1]->type != TYPE_NUMBER ||
+        arguments[2]->type != TYPE_NUMBER) {
+        return Value__create_nil();
+    }
+
+    List* list = (List*)arguments[0]->as.raw;
+    double length = (double)list->length;
+    double start = arguments[1]->as.number;
+    double end = arguments[2]->as.number;
+
+    // clamped without fmin/fmax (programs aren't linked with libm), NaN is 0
+    start = !(start > 0) ? 0 : start > length ? length : start;
+    end = !(end > 0) ? 0 : end > length ? length : end;
+
+    Value* result = Value__create_list();
+    if (start < end) {
+        List__append_range((List*)result->as.raw, list, (size_t)start,
+                           (size_t)end - (size_t)start);
+    }
+    return result;
+}
+
+Value* lists_reverse__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST) return Value__create_nil();
+
+    List* list = (List*)arguments[0]->as.raw;
+    Value* result = Value__create_list();
+    List* reversed = (List*)result->as.raw;
+    List__reserve(reversed, list->length);
+
+    for (size_t i = 0; i < list->length; i++) {
+        Value element = List__get(list, list->length - 1 - i);
+        Value__copy(&reversed->arr[i], &element);
+    }
+    reversed->length = list->length;
+
+    return result;
+}
+
+// the position of the first element equal to `value`, -1 if there's none
+static long Lists__find(List* list, Value* value) {
+    for (size_t i = 0; i < list->length; i++) {
+        Value element = List__get(list, i);
+        if (Value__equals(&element, value)) return (long)i;
+    }
+    return -1;
+}
+
+Value* lists_indexOf__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST) return Value__create_nil();
+    return Value__from_double(
+        (double)Lists__find((List*)arguments[0]->as.raw, arguments[1]));
+}
+
+Value* lists_contains__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST) return Value__create_nil();
+    return Value__from_bool(
+        Lists__find((List*)arguments[0]->as.raw, arguments[1]) >= 0);
+}
+
+/*
+    lists.join(list, delimiter), the string forms of the elements with the
+    delimiter in between. the string is sized up front for the elements
+    that are already strings.
+*/
+Value* lists_join__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST || arguments[1]->type != TYPE_STRING) {
+        return Value__create_nil();
+    }
+
+    List* list = (List*)arguments[0]->as.raw;
+    String* delimiter = (String*)arguments[1]->as.raw;
+
+    size_t capacity = 0;
+    for (size_t i = 0; i < list->length; i++) {
+        Value element = List__get(list, i);
+        if (element.type == TYPE_STRING) {
+            capacity += ((String*)element.as.raw)->length;
+        }
+        if (i != 0) capacity += delimiter->length;
+    }
+
+    StringBuffer* buffer = StringBuffer__create(capacity);
+    for (size_t i = 0; i < list->length; i++) {
+        if (i != 0) {
+            StringBuffer__append(buffer, delimiter->chars, delimiter->length);
+        }
+        Value element = List__get(list, i);
+        StringBuffer__append_value(buffer, &element);
+    }
+
+    return Value__from_string(String__from_buffer(buffer));
+}
+
+/*
+    the callback could change the list it's going through, marking it as
+    shared makes anything that writes to it copy it first.
+*/
+static List* Lists__callback_list(Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST ||
+        arguments[1]->type != TYPE_FUNCTION) {
+        return NULL;
+    }
+
+    List* list = (List*)arguments[0]->as.raw;
+    LINX_SHARE(list);
+    return list;
+}
+
+// lists.map(list, callback), a new list of the results of the callback
+Value* lists_map__builtin_def(Value** environment, Value** arguments) {
+    List* list = Lists__callback_list(arguments);
+    if (list == NULL) return Value__create_nil();
+
+    Value* result = Value__create_list();
+    List* results = (List*)result->as.raw;
+    List__reserve(results, list->length);
+
+    for (size_t i = 0; i < list->length; i++) {
+        Value element = List__get(list, i);
+        Value* mapped = linx__operator_call(
+            arguments[1], (Value*[]){Value__from_value(&element)});
+        Value__copy(&results->arr[results->length++], mapped);
+    }
+
+    return result;
+}
+
+// lists.filter(list, callback), the elements the callback returns truthy for
+Value* lists_filter__builtin_def(Value** environment, Value** arguments) {
+    List* list = Lists__callback_list(arguments);
+    if (list == NULL) return Value__create_nil();
+
+    Value* result = Value__create_list();
+    List* results = (List*)result->as.raw;
+
+    for (size_t i = 0; i < list->length; i++) {
+        Value element = List__get(list, i);
+        Value* keep = linx__operator_call(
+            arguments[1], (Value*[]){Value__from_value(&element)});
+        if (Value__to_bool(keep)) List__append(results, &element);
+    }
+
+    return result;
+}
+
+/*
+    `sort(list)` & `sortBy(list, compare)` return a sorted copy of a list.
+    both are stable, elements that are ordered the same keep their order.
+
+    without a comparison function values are ordered the same as by `<`,
+    values of different types by their type. lists of only numbers or
+    only strings are sorted by unboxed keys: numbers by a radix sort of
+    their bits, strings by introsort (which isn't stable, but equal
+    strings can't be told apart). everything else, including every sort
+    with a comparison function, is merge sorted, which makes the fewest
+    calls to the comparison function.
+
+    the key buffers are scratch space that nothing else points to & don't
+    point to anything the list doesn't, so they're allocated outside tgc
+    (which would otherwise scan them).
+*/
+#define SORT_INSERTION_LENGTH 16
+#define SORT_RADIX_BITS 11
+#define SORT_RADIX_DIGITS (1 << SORT_RADIX_BITS)
+#define SORT_RADIX_PASSES 6  // 64 bit keys
+
+// the default order, the same as `<` for values of the same type
+static int Sort__compare(Value* lhs, Value* rhs) {
+    if (lhs->type != rhs->type) return lhs->type < rhs->type ? -1 : 1;
+
+    switch (lhs->type) {
+        case TYPE_BOOLEAN:
+            return lhs->as.boolean - rhs->as.boolean;
+        case TYPE_NUMBER: {
+            // NaN isn't ordered by `<`, so it goes after every other number
+            double a = lhs->as.number, b = rhs->as.number;
+            if (isnan(a) || isnan(b)) return isnan(a) - isnan(b);
+            return (a > b) - (a < b);
+        }
+        case TYPE_STRING:
+            return String__compare((String*)lhs->as.raw,
+                                   (String*)rhs->as.raw);
+        case TYPE_LIST: {
+            size_t a = ((List*)lhs->as.raw)->length;
+            size_t b = ((List*)rhs->as.raw)->length;
+            return (a > b) - (a < b);
+        }
+        case TYPE_OBJECT: {
+            size_t a = ((Object*)lhs->as.raw)->keys->length;
+            size_t b = ((Object*)rhs->as.raw)->keys->length;
+            return (a > b) - (a < b);
+        }
+        default:
+            return 0;
+    }
+}
+
+// `compare` is the comparison function, `NULL` for the default order
+static int Sort__order(Value* compare, Value* lhs, Value* rhs) {
+    if (compare == NULL) return Sort__compare(lhs, rhs);
+
+    Value* result = linx__operator_call(
+        compare, (Value*[]){Value__from_value(lhs), Value__from_value(rhs)});
+    if (result->type != TYPE_NUMBER) return 0;
+    return (result->as.number > 0) - (result->as.number < 0);
+}
+
+// `scratch` has room for half of the values
+static void Sort__merge(Value* values, Value* scratch, size_t length,
+                        Value* compare) {
+    if (length < 2) return;
+
+    size_t middle = length / 2;
+    Sort__merge(values, scratch, middle, compare);
+    Sort__merge(values + middle, scratch, length - middle, compare);
+
+    // the halves are already in order, e.g. if the list was sorted
+    if (Sort__order(compare, &values[middle - 1], &values[middle]) <= 0) {
+        return;
+    }
+
+    memcpy(scratch, values, sizeof(Value) * middle);
+    size_t left = 0, right = middle, next = 0;
+    while (left < middle && right < length) {
+        // ties are taken from the left half, which keeps the sort stable
+        if (Sort__order(compare, &values[right], &scratch[left]) < 0) {
+            values[next++] = values[right++];
+        } else {
+            values[next++] = scratch[left++];
+        }
+    }
+    while (left < middle) values[next++] = scratch[left++];
+}
+
+/*
+    doubles as integers that are ordered the same way: positive numbers get
+    their sign bit set, negative ones have every bit flipped (their bits
+    grow as they get smaller). NaNs all become the same positive NaN, which
+    goes after infinity. -0 gets the key of 0, since `<` doesn't order
+    them (`Sort__numbers` gives the zeros their signs back).
+*/
+static unsigned long long Sort__number_key(double number) {
+    if (isnan(number)) number = NAN;
+    if (number == 0) number = 0;
+
+    unsigned long long bits;
+    memcpy(&bits, &number, sizeof(bits));
+    return bits >> 63 ? ~bits : bits | (1ull << 63);
+}
+
+static double Sort__key_number(unsigned long long key) {
+    unsigned long long bits = key >> 63 ? key & ~(1ull << 63) : ~key;
+
+    double number;
+    memcpy(&number, &bits, sizeof(number));
+    return number;
+}
+
+// LSD radix sort, skipping the digits every key has in common
+static void Sort__radix(unsigned long long* keys, unsigned long long* scratch,
+                        size_t length) {
+    size_t(*counts)[SORT_RADIX_DIGITS] =
+        calloc(SORT_RADIX_PASSES, sizeof(*counts));
+    for (size_t i = 0; i < length; i++) {
+        for (int pass = 0; pass < SORT_RADIX_PASSES; pass++) {
+            counts[pass][(keys[i] >> (pass * SORT_RADIX_BITS)) &
+                         (SORT_RADIX_DIGITS - 1)]++;
+        }
+    }
+
+    unsigned long long* from = keys;
+    unsigned long long* to = scratch;
+    for (int pass = 0; pass < SORT_RADIX_PASSES; pass++) {
+        int shift = pass * SORT_RADIX_BITS;
+        size_t* count = counts[pass];
+        if (count[(from[0] >> shift) & (SORT_RADIX_DIGITS - 1)] == length) {
+            continue;
+        }
+
+        // each digit's count becomes the position its keys start at
+        size_t position = 0;
+        for (size_t digit = 0; digit < SORT_RADIX_DIGITS; digit++) {
+            size_t digit_count = count[digit];
+            count[digit] = position;
+            position += digit_count;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            to[count[(from[i] >> shift) & (SORT_RADIX_DIGITS - 1)]++] =
+                from[i];
+        }
+
+        unsigned long long* sorted = to;
+        to = from;
+        from = sorted;
+    }
+
+    if (from != keys) memcpy(keys, from, sizeof(*keys) * length);
+    free(counts);
+}
+
+static void Sort__numbers(List* list, List* sorted) {
+    size_t length = list->length;
+    unsigned long long* keys = malloc(sizeof(*keys) * length * 2);
+    for (size_t i = 0; i < length; i++) {
+        keys[i] = Sort__number_key(List__get(list, i).as.number);
+    }
+
+    if (length <= SORT_INSERTION_LENGTH) {
+        for (size_t i = 1; i < length; i++) {
+            unsigned long long key = keys[i];
+            size_t j = i;
+            for (; j > 0 && keys[j - 1] > key; j--) keys[j] = keys[j - 1];
+            keys[j] = key;
+        }
+    } else {
+        Sort__radix(keys, keys + length, length);
+    }
+
+    // the zeros are put back in the order they were in, like a stable sort
+    size_t zero = 0;
+    for (size_t i = 0; i < length; i++) {
+        double number = Sort__key_number(keys[i]);
+        if (number == 0) {
+            while (List__get(list, zero).as.number != 0) zero++;
+            number = List__get(list, zero++).as.number;
+        }
+
+        sorted->arr[i].type = TYPE_NUMBER;
+        sorted->arr[i].as.number = number;
+    }
+    free(keys);
+}
+
+static void Sort__swap_strings(String** strings, size_t a, size_t b) {
+    String* swapped = strings[a];
+    strings[a] = strings[b];
+    strings[b] = swapped;
+}
+
+static void Sort__sift_strings(String** strings, size_t root,
+                               size_t length) {
+    for (size_t child = 2 * root + 1; child < length;
+         root = child, child = 2 * root + 1) {
+        if (child + 1 < length &&
+            String__compare(strings[child], strings[child + 1]) < 0) {
+            child++;
+        }
+        if (String__compare(strings[root], strings[child]) >= 0) return;
+        Sort__swap_strings(strings, root, child);
+    }
+}
+
+/*
+    introsort: quicksort with a median of three pivot, falling back to
+    heapsort once it's gone `depth` partitions deep (so bad pivots can't
+    make it quadratic), & insertion sort for what's left of short ranges.
+*/
+static void Sort__strings(String** strings, size_t length, size_t depth) {
+    while (length > SORT_INSERTION_LENGTH) {
+        if (depth-- == 0) {
+            for (size_t i = length / 2; i-- > 0;) {
+                Sort__sift_strings(strings, i, length);
+            }
+            for (size_t end = length - 1; end > 0; end--) {
+                Sort__swap_strings(strings, 0, end);
+                Sort__sift_strings(strings, 0, end);
+            }
+            return;
+        }
+
+        // orders the first, middle & last strings, the median is the pivot
+        size_t middle = length / 2, last = length - 1;
+        if (String__compare(strings[middle], strings[0]) < 0) {
+            Sort__swap_strings(strings, middle, 0);
+        }
+        if (String__compare(strings[last], strings[middle]) < 0) {
+            Sort__swap_strings(strings, last, middle);
+            if (String__compare(strings[middle], strings[0]) < 0) {
+                Sort__swap_strings(strings, middle, 0);
+            }
+        }
+        String* pivot = strings[middle];
+
+        // hoare partition, both sides stop on strings equal to the pivot
+        size_t i = 0, j = last;
+        while (true) {
+            while (String__compare(strings[i], pivot) < 0) i++;
+            while (String__compare(pivot, strings[j]) < 0) j--;
+            if (i >= j) break;
+            Sort__swap_strings(strings, i++, j--);
+        }
+
+        // recursing into the smaller side bounds the stack's depth
+        size_t split = j + 1;
+        if (split < length - split) {
+            Sort__strings(strings, split, depth);
+            strings += split;
+            length -= split;
+        } else {
+            Sort__strings(strings + split, length - split, depth);
+            length = split;
+        }
+    }
+
+    for (size_t i = 1; i < length; i++) {
+        String* string = strings[i];
+        size_t j = i;
+        for (; j > 0 && String__compare(strings[j - 1], string) > 0; j--) {
+            strings[j] = strings[j - 1];
+        }
+        strings[j] = string;
+    }
+}
+
+// merge sorts a copy of the list into `sorted`
+static void Sort__values(List* list, List* sorted, Value* compare) {
+    List__append_all(sorted, list);
+    if (sorted->length < 2) return;
+
+    Value* scratch = linx_malloc(TYPE_LIST, sizeof(Value) * (list->length / 2));
+    Sort__merge(sorted->arr, scratch, sorted->length, compare);
+    linx_free(scratch);
+}
+
+Value* sort__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST) return Value__create_nil();
+
+    List* list = (List*)arguments[0]->as.raw;
+    Value* result = Value__create_list();
+    List* sorted = (List*)result->as.raw;
+    List__reserve(sorted, list->length);
+
+    bool numbers = true, strings = true;
+    for (size_t i = 0; i < list->length && (numbers || strings); i++) {
+        Type type = List__get(list, i).type;
+        numbers = numbers && type == TYPE_NUMBER;
+        strings = strings && type == TYPE_STRING;
+    }
+
+    if (numbers) {
+        Sort__numbers(list, sorted);
+    } else if (strings) {
+        String** keys = malloc(sizeof(String*) * list->length);
+        for (size_t i = 0; i < list->length; i++) {
+            keys[i] = (String*)list->arr[i].as.raw;
+        }
+
+        size_t depth = 0;
+        for (size_t length = list->length; length > 1; length /= 2) {
+            depth += 2;
+        }
+        Sort__strings(keys, list->length, depth);
+
+        for (size_t i = 0; i < list->length; i++) {
+            sorted->arr[i].type = TYPE_STRING;
+            sorted->arr[i].as.raw = keys[i];
+        }
+        free(keys);
+    } else {
+        Sort__values(list, sorted, NULL);
+    }
+
+    sorted->length = list->length;
+    return result;
+}
+
+// sortBy(list, compare), `compare(a, b)` is negative if a goes before b
+Value* sortBy__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST ||
+        arguments[1]->type != TYPE_FUNCTION) {
+        return Value__create_nil();
+    }
+
+    // the comparison function could change the list while it's sorted
+    List* list = (List*)arguments[0]->as.raw;
+    LINX_SHARE(list);
+
+    Value* result = Value__create_list();
+    List* sorted = (List*)result->as.raw;
+    Sort__values(list, sorted, arguments[1]);
+    return result;
+}
+
+// functions that are never collected, e.g. the builtins
+Value* Value__create_immortal_fn(fnptr fn) {
+    Value* result = linx_malloc_root(sizeof(Value));
+    result->type = TYPE_FUNCTION;
+    result->as.raw = linx_malloc_root(sizeof(Function));
+    ((Function*)result->as.raw)->call = fn;
+    ((Function*)result->as.raw)->environment_length = 0;
+    return result;
+}
+
+// objects of builtins like `parallel` & `fs`, kept alive by a root value
+Value* Value__create_builtin_object(const char** names, fnptr* fns,
+                                    size_t length) {
+    Value* keys[length];
+    Value* values[length];
+    for (size_t i = 0; i < length; i++) {
+        keys[i] = Value__intern(names[i]);
+        values[i] = Value__create_immortal_fn(fns[i]);
+    }
+
+    Value* result = linx_malloc_root(sizeof(Value));
+    Value__copy(result, Value__create_object_from_arrs(keys, values, length));
+    return result;
+}
+
+/*
+    a work stealing thread pool for the parallel builtins. a job is split
+    into tasks numbered 0..n, which are dealt out to the workers as even
+    ranges. each worker takes tasks from the front of its own range, &
+    once it runs out steals the back half of another worker's.
+
+    the thread that starts a job works on it as worker 0, the others are
+    started the first time a job runs & sleep in between jobs. tgc only
+    scans the main thread's stack, so collections are paused while a job
+    runs, until every worker is done with it.
+*/
+#define POOL_MAX_WORKERS 64
+
+// tasks per worker for `parallel.map`, so stealing can balance the load
+#define PARALLEL_MAP_TASKS_PER_WORKER 8
+
+/*
+    `parallel.reduce` always folds chunks of this many elements, however
+    many threads there are, so its results don't depend on the machine.
+    the JS runtime uses the same chunks.
+*/
+#define PARALLEL_REDUCE_CHUNK 256
+
+typedef struct {
+    List* list;
+    Value* fn;
+    size_t chunk;  // elements per task
+    Value* initial;  // `NULL` for maps
+
+    // one per element for maps, one per task for reductions
+    Value* results;
+} ParallelJob;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+
+    // the tasks the worker has left
+    size_t next;
+    size_t end;
+} Worker;
+
+static struct {
+    Worker* workers;
+    size_t length;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    size_t generation;  // incremented for every job
+    size_t running;  // workers other than the caller still on the job
+
+    ParallelJob* job;
+} pool = {NULL, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+          PTHREAD_COND_INITIALIZER, 0, 0, NULL};
+
+static Value* Parallel__element(ParallelJob* job, size_t index) {
+    Value element = List__get(job->list, index);
+    return Value__from_value(&element);
+}
+
+static void Parallel__run_task(ParallelJob* job, size_t task) {
+    size_t start = task * job->chunk;
+    size_t end = start + job->chunk;
+    if (end > job->list->length) end = job->list->length;
+
+    if (job->initial == NULL) {
+        for (size_t i = start; i < end; i++) {
+            Value* result = linx__operator_call(
+                job->fn, (Value*[]){Parallel__element(job, i)});
+            Value__copy(&job->results[i], result);
+        }
+        return;
+    }
+
+    // only the first chunk starts from the initial value
+    Value* result =
+        task == 0 ? job->initial : Parallel__element(job, start++);
+    for (size_t i = start; i < end; i++) {
+        result = linx__operator_call(
+            job->fn, (Value*[]){result, Parallel__element(job, i)});
+    }
+    Value__copy(&job->results[task], result);
+}
+
+static bool Pool__next_task(size_t id, size_t* task) {
+    Worker* self = &pool.workers[id];
+
+    pthread_mutex_lock(&self->lock);
+    bool found = self->next < self->end;
+    if (found) *task = self->next++;
+    pthread_mutex_unlock(&self->lock);
+    if (found) return true;
+
+    for (size_t i = 1; i < pool.length; i++) {
+        Worker* victim = &pool.workers[(id + i) % pool.length];
+
+        pthread_mutex_lock(&victim->lock);
+        size_t end = victim->end;
+        size_t start = end - (end - victim->next + 1) / 2;
+        victim->end = start;
+        pthread_mutex_unlock(&victim->lock);
+        if (start == end) continue;
+
+        pthread_mutex_lock(&self->lock);
+        self->next = start + 1;
+        self->end = end;
+        pthread_mutex_unlock(&self->lock);
+
+        *task = start;
+        return true;
+    }
+
+    return false;
+}
+
+static void Pool__work(size_t id) {
+    size_t task;
+    while (Pool__next_task(id, &task)) Parallel__run_task(pool.job, task);
+}
+
+static void* Pool__worker(void* argument) {
+    size_t id = (size_t)argument;
+
+    // the worker's nursery scans the stack from here
+    int stack_bottom;
+    nursery.stack_bottom = &stack_bottom;
+
+    size_t generation = 0;
+    pthread_mutex_lock(&pool.lock);
+    while (true) {
+        while (pool.generation == generation) {
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        }
+        generation = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+
+        Pool__work(id);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.running == 0) pthread_cond_signal(&pool.done);
+    }
+
+    return NULL;
+}
+
+// one worker per core, unless `LINX_THREADS` says otherwise
+static void Pool__start() {
+    const char* threads = getenv("LINX_THREADS");
+    long length = threads != NULL ? atol(threads)
+                                  : sysconf(_SC_NPROCESSORS_ONLN);
+    if (length < 1) length = 1;
+    if (length > POOL_MAX_WORKERS) length = POOL_MAX_WORKERS;
+
+    pool.workers = linx_malloc_root(sizeof(Worker) * length);
+    pool.length = (size_t)length;
+
+    for (size_t i = 0; i < pool.length; i++) {
+        pthread_mutex_init(&pool.workers[i].lock, NULL);
+        pool.workers[i].next = pool.workers[i].end = 0;
+        if (i == 0) continue;
+
+        if (pthread_create(&pool.workers[i].thread, NULL, Pool__worker,
+                           (void*)i) != 0) {
+            // run with the workers that could be started
+            pool.length = i;
+            break;
+        }
+    }
+}
+
+static void Pool__run(ParallelJob* job, size_t tasks) {
+    if (pool.workers == NULL) Pool__start();
+
+    // jobs started by a job, & jobs too small to split, run right here
+    if (linx_threads_active || pool.length == 1 || tasks < 2) {
+        for (size_t task = 0; task < tasks; task++) {
+            Parallel__run_task(job, task);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < pool.length; i++) {
+        pool.workers[i].next = tasks * i / pool.length;
+        pool.workers[i].end = tasks * (i + 1) / pool.length;
+    }
+
+    pool.job = job;
+    linx_threads_active = true;
+    tgc_pause(&gc);
+
+    pthread_mutex_lock(&pool.lock);
+    pool.generation++;
+    pool.running = pool.length - 1;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    Pool__work(0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.running > 0) pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+
+    linx_threads_active = false;
+    tgc_resume(&gc);
+}
+
+/*
+    parallel.map(list, fn), like mapping over the list with a loop but
+    with the calls spread over every core. the results are in the order
+    of the list. `fn` shouldn't assign to variables it captures, the
+    calls run at the same time.
+*/
+Value* parallel_map__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST ||
+        arguments[1]->type != TYPE_FUNCTION) {
+        return Value__create_nil();
+    }
+
+    List* list = (List*)arguments[0]->as.raw;
+
+    // the workers read the list, anything that writes to it has to copy it
+    LINX_SHARE(list);
+
+    Value* result = Value__create_list();
+    List* results = (List*)result->as.raw;
+    List__reserve(results, list->length);
+
+    if (pool.workers == NULL) Pool__start();
+    size_t tasks = PARALLEL_MAP_TASKS_PER_WORKER * pool.length;
+    if (tasks > list->length) tasks = list->length;
+
+    ParallelJob job = {list, arguments[1], 1, NULL, results->arr};
+    if (tasks > 0) {
+        job.chunk = (list->length + tasks - 1) / tasks;
+        tasks = (list->length + job.chunk - 1) / job.chunk;
+    }
+    Pool__run(&job, tasks);
+
+    results->length = list->length;
+    return result;
+}
+
+/*
+    parallel.reduce(list, fn, initial), the same as folding the list from
+    the left with `fn` as long as `fn` is associative (e.g. `a + b`): the
+    list is folded in chunks at the same time, then the results of the
+    chunks are folded together.
+*/
+Value* parallel_reduce__builtin_def(Value** environment, Value** arguments) {
+    if (arguments[0]->type != TYPE_LIST ||
+        arguments[1]->type != TYPE_FUNCTION) {
+        return Value__create_nil();
+    }
+
+    List* list = (List*)arguments[0]->as.raw;
+    if (list->length == 0) return Value__from_value(arguments[2]);
+    LINX_SHARE(list);
+
+    size_t tasks =
+        (list->length + PARALLEL_REDUCE_CHUNK - 1) / PARALLEL_REDUCE_CHUNK;
+    ParallelJob job = {list, arguments[1], PARALLEL_REDUCE_CHUNK,
+                       arguments[2],
+                       linx_malloc(TYPE_LIST, sizeof(Value) * tasks)};
+    Pool__run(&job, tasks);
+
+    Value* result = Value__from_value(&job.results[0]);
+    for (size_t task = 1; task < tasks; task++) {
+        result = linx__operator_call(
+            arguments[1],
+            (Value*[]){result, Value__from_value(&job.results[task])});
+    }
+    return result;
+}
+
+/*
+    *-----------------*
+    |   File system   |
+    *-----------------*
+*/
+
+// file contents mapped into memory, unmapped once tgc collects the string
+typedef struct {
+    String string;
+    size_t mapped;
+} MappedString;
+
+static void MappedString__unmap(void* pointer) {
+    MappedString* mapped = pointer;
+    munmap(mapped->string.chars, mapped->mapped);
+}
+
+/*
+    maps the file at `path` into a string without copying it. the pages are
+    only read in from the file as they're used, so a file can be much
+    larger than the memory available. the file shouldn't be changed while
+    the string is around, the string would change with it.
+
+    the mapping is reserved a byte longer than the file (anonymous memory
+    where the file ends on a page boundary) so the contents are always NUL
+    terminated. returns `NULL` if the file can't be read.
+*/
+String* String__map_file(const char* path) {
+    int file = open(path, O_RDONLY);
+    if (file < 0) return NULL;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(file);
+        return NULL;
+    }
+
+    size_t length = (size_t)info.st_size;
+    if (length == 0) {
+        close(file);
+        return String__create("", 0);
+    }
+
+    size_t mapped = length + 1;
+    char* chars = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1, 0);
+    if (chars != MAP_FAILED &&
+        mmap(chars, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, file, 0) ==
+            MAP_FAILED) {
+        munmap(chars, mapped);
+        chars = MAP_FAILED;
+    }
+    close(file);
+    if (chars == MAP_FAILED) return NULL;
+
+    LINX_LOCK(linx_heap_lock);
+    PROFILE(profile.allocations[TYPE_STRING]++;
+            profile.bytes[TYPE_STRING] += sizeof(MappedString));
+    MappedString* result =
+        tgc_alloc_opt(&gc, sizeof(MappedString), 0, MappedString__unmap);
+    LINX_UNLOCK(linx_heap_lock);
+
+    result->mapped = mapped;
+    result->string.length = length;
+    result->string.hash = 0;
+    result->string.interned = false;
+    result->string.buffer = NULL;
+    result->string.chars = chars;
+    return &result->string;
+}
+
+// the path argument of the `fs` functions, `NULL` if it isn't a string
+static const char* Fs__path(Value* value) {
+    if (value->type != TYPE_STRING) return NULL;
+    return String__to_charptr((String*)value->as.raw);
+}
+
+// writes the string form of `value`, the same as `toString` gives
+static bool Fs__write(FILE* file, Value* value) {
+    String* str = Value__to_string(value);
+    return fwrite(str->chars, 1, str->length, file) == str->length;
+}
+
+static Value* Fs__write_file(Value** arguments, const char* mode) {
+    const char* path = Fs__path(arguments[0]);
+    FILE* file = path == NULL ? NULL : fopen(path, mode);
+    if (file == NULL) return Value__from_bool(false);
+
+    bool written = Fs__write(file, arguments[1]);
+    return Value__from_bool(fclose(file) == 0 && written);
+}
+
+// fs.readFile(path), the contents of the file or nil
+Value* fs_readFile__builtin_def(Value** environment, Value** arguments) {
+    const char* path = Fs__path(arguments[0]);
+    String* contents = path == NULL ? NULL : String__map_file(path);
+    if (contents == NULL) return Value__create_nil();
+    return Value__from_string(contents);
+}
+
+// fs.writeFile(path, content) & fs.appendFile(path, content)
+Value* fs_writeFile__builtin_def(Value** environment, Value** arguments) {
+    return Fs__write_file(arguments, "wb");
+}
+
+Value* fs_appendFile__builtin_def(Value** environment, Value** arguments) {
+    return Fs__write_file(arguments, "ab");
+}
+
+/*
+    files opened by `fs.writer`, its closures refer to their file by its
+    index in here. files that are never closed are flushed on exit.
+*/
+#define WRITER_BUFFER_SIZE (64 * 1024)
+
+static FILE** writers = NULL;
+static size_t writers_length = 0;
+static size_t writers_capacity = 0;
+
+static FILE* Fs__writer(Value** environment) {
+    LINX_LOCK(linx_shared_lock);
+    FILE* file = writers[(size_t)environment[0]->as.number];
+    LINX_UNLOCK(linx_shared_lock);
+    return file;
+}
+
+static Value* writer_write__linx_definition(Value** environment,
+                                            Value** arguments) {
+    FILE* file = Fs__writer(environment);
+    return Value__from_bool(file != NULL && Fs__write(file, arguments[0]));
+}
+
+static Value* writer_close__linx_definition(Value** environment,
+                                            Value** arguments) {
+    FILE* file = Fs__writer(environment);
+    if (file == NULL) return Value__from_bool(false);
+
+    LINX_LOCK(linx_shared_lock);
+    writers[(size_t)environment[0]->as.number] = NULL;
+    LINX_UNLOCK(linx_shared_lock);
+
+    return Value__from_bool(fclose(file) == 0);
+}
+
+/*
+    fs.writer(path), a buffered writer for writing a file piece by piece:
+    an object with `write(value)` & `close()`.
+*/
+Value* fs_writer__builtin_def(Value** environment, Value** arguments) {
+    static Value* write_key = NULL;
+    static Value* close_key = NULL;
+    if (write_key == NULL) {
+        write_key = Value__intern("write");
+        close_key = Value__intern("close");
+    }
+
+    const char* path = Fs__path(arguments[0]);
+    FILE* file = path == NULL ? NULL : fopen(path, "wb");
+    if (file == NULL) return Value__create_nil();
+    setvbuf(file, NULL, _IOFBF, WRITER_BUFFER_SIZE);
+
+    LINX_LOCK(linx_shared_lock);
+    if (writers_length == writers_capacity) {
+        writers_capacity = writers_capacity == 0 ? 8 : writers_capacity * 2;
+        FILE** grown = linx_malloc_root(sizeof(FILE*) * writers_capacity);
+        for (size_t i = 0; i < writers_length; i++) grown[i] = writers[i];
+        if (writers != NULL) linx_free(writers);
+        writers = grown;
+    }
+    size_t index = writers_length++;
+    writers[index] = file;
+    LINX_UNLOCK(linx_shared_lock);
+
+    Value* handle = Value__from_double((double)index);
+    Value* write = Value__create_fn(&writer_write__linx_definition,
+                                    (Value*[]){handle}, 1, 1);
+    Value* close = Value__create_fn(&writer_close__linx_definition,
+                                    (Value*[]){handle}, 1, 1);
+    return Value__create_object_from_arrs((Value*[]){write_key, close_key},
+                                          (Value*[]){write, close}, 2);
+}
+
+static Value* lines_valid__linx_definition(Value** environment,
+                                           Value** arguments) {
+    String* file = (String*)environment[1]->as.raw;
+    return Value__from_bool(environment[0]->as.number < file->length);
+}
+
+// lines end at "\n" or "\r\n", neither is part of the line
+static Value* lines_next__linx_definition(Value** environment,
+                                          Value** arguments) {
+    String* file = (String*)environment[1]->as.raw;
+    size_t offset = (size_t)environment[0]->as.number;
+    if (offset >= file->length) return Value__create_nil();
+
+    const char* start = file->chars + offset;
+    const char* end = memchr(start, '\n', file->length - offset);
+    size_t length = end == NULL ? file->length - offset : (size_t)(end - start);
+
+    environment[0]->as.number = (double)(offset + length + 1);
+    if (length > 0 && start[length - 1] == '\r') length--;
+    return Value__from_string(String__create(start, length));
+}
+
+/*
+    fs.lines(path), an iterator over the lines of a file. the file is
+    mapped (see `String__map_file`) & read in as the lines are, so the
+    lines of any size of file can be gone through.
+*/
+Value* fs_lines__builtin_def(Value** environment, Value** arguments) {
+    Value* file = fs_readFile__builtin_def(NULL, arguments);
+    if (file->type != TYPE_STRING) return file;
+
+    // the kernel can read ahead & drop the pages that have been read
+    String* contents = (String*)file->as.raw;
+    if (contents->length > 0) {
+        madvise(contents->chars, contents->length, MADV_SEQUENTIAL);
+    }
+
+    // the offset is shared by both closures, the file is copied into them
+    Value* offset = Value__create_cell(Value__from_double(0));
+    Value* next = Value__create_fn(&lines_next__linx_definition,
+                                   (Value*[]){offset, file}, 2, 1);
+    Value* valid = Value__create_fn(&lines_valid__linx_definition,
+                                    (Value*[]){offset, file}, 2, 1);
+    return Value__create_object_from_arrs(
+        (Value*[]){iterator_next_key, iterator_valid_key},
+        (Value*[]){next, valid}, 2);
+}
+
+// fs.stat(path), an object with the file's size, type & modification time
+Value* fs_stat__builtin_def(Value** environment, Value** arguments) {
+    static Value* keys[4] = {NULL};
+    if (keys[0] == NULL) {
+        keys[0] = Value__intern("size");
+        keys[1] = Value__intern("isFile");
+        keys[2] = Value__intern("isDirectory");
+        keys[3] = Value__intern("modified");
+    }
+
+    const char* path = Fs__path(arguments[0]);
+    struct stat info;
+    if (path == NULL || stat(path, &info) != 0) return Value__create_nil();
+
+    return Value__create_object_from_arrs(
+        keys,
+        (Value*[]){Value__from_double((double)info.st_size),
+                   Value__from_bool(S_ISREG(info.st_mode)),
+                   Value__from_bool(S_ISDIR(info.st_mode)),
+                   Value__from_double((double)info.st_mtime)},
+        4);
+}
+
+Value* fs_exists__builtin_def(Value** environment, Value** arguments) {
+    const char* path = Fs__path(arguments[0]);
+    struct stat info;
+    return Value__from_bool(path != NULL && stat(path, &info) == 0);
+}
+
+// fs.ensure(path), creates the directory & every missing parent of it
+Value* fs_ensure__builtin_def(Value** environment, Value** arguments) {
+    const char* path = Fs__path(arguments[0]);
+    if (path == NULL) return Value__from_bool(false);
+
+    size_t length = strlen(path);
+    char* partial = linx_malloc(TYPE_STRING, length + 1);
+    memcpy(partial, path, length + 1);
+
+    for (size_t i = 1; i <= length; i++) {
+        if (partial[i] != '/' && partial[i] != '\0') continue;
+
+        char separator = partial[i];
+        partial[i] = '\0';
+        if (mkdir(partial, 0777) != 0 && errno != EEXIST) {
+            return Value__from_bool(false);
+        }
+        partial[i] = separator;
+    }
+
+    struct stat info;
+    return Value__from_bool(stat(path, &info) == 0 && S_ISDIR(info.st_mode));
+}
+
+Iterator Iterator__create(Value* value) {
+    Iterator result = {TYPE_NIL, NULL, 0, 0, 0, 0};
+
+    // iterator objects are marked as functions, their methods are called
+    if (Iterator__is_object(value)) {
+        result.type = TYPE_FUNCTION;
+        result.raw = value->as.raw;
+        return result;
+    }
+
+    // other values can't be iterated over, the loop just doesn't run
+    if (value->type == TYPE_LIST || value->type == TYPE_STRING ||
+        value->type == TYPE_OBJECT) {
+        result.type = value->type;
+        result.raw = value->as.raw;
+    }
+
+    return result;
+}
+
+// `for i in start..end` (or an explicit `range` call)
+Iterator Iterator__range(Value* start, Value* end, Value* step) {
+    Iterator result = {TYPE_NUMBER, NULL, 0, 0, 0, 0};
+
+    if (start->type == TYPE_NUMBER && end->type == TYPE_NUMBER &&
+        step->type == TYPE_NUMBER && step->as.number > 0) {
+        bool forwards = start->as.number < end->as.number;
+        result.length =
+            Range__length(start->as.number, end->as.number, step->as.number);
+        result.start = start->as.number;
+        result.step = forwards ? step->as.number : -step->as.number;
+    }
+
+    return result;
+}
+
+bool Iterator__valid(Iterator* iter) {
+    switch (iter->type) {
+        case TYPE_NUMBER:
+            return iter->index < iter->length;
+        case TYPE_LIST:
+            return iter->index < ((List*)iter->raw)->length;
+        case TYPE_STRING:
+            return iter->index < ((String*)iter->raw)->length;
+        case TYPE_OBJECT:
+            return iter->index < ((Object*)iter->raw)->keys->length;
+        case TYPE_FUNCTION: {
+            Value* valid = Iterator__method(iter->raw, iterator_valid_key);
+            return valid && Value__to_bool(linx__operator_call(valid, NULL));
+        }
+        default:
+            return false;
+    }
+}
+
+Value* Iterator__next(Iterator* iter) {
+    size_t index = iter->index++;
+
+    switch (iter->type) {
+        case TYPE_NUMBER:
+            return Value__from_double(iter->start + index * iter->step);
+        case TYPE_LIST: {
+            Value element = List__get((List*)iter->raw, index);
+            return Value__from_value(&element);
+        }
+        case TYPE_STRING:
+            return Value__from_string(
+                String__create(((String*)iter->raw)->chars + index, 1));
+        case TYPE_OBJECT: {
+            // objects are iterated as [key, value] pairs
+            Object* object = (Object*)iter->raw;
+            Value* result = Value__create_list();
+            List* pair = (List*)result->as.raw;
+
+            List__reserve(pair, 2);
+            Value__copy(&pair->arr[0], &object->keys->arr[index]);
+            Value__copy(&pair->arr[1], &object->values->arr[index]);
+            pair->length = 2;
+            return result;
+        }
+        case TYPE_FUNCTION: {
+            Value* next = Iterator__method(iter->raw, iterator_next_key);
+            return next ? linx__operator_call(next, NULL)
+                        : Value__create_nil();
+        }
+        default:
+            return Value__create_nil();
+    }
+}
+
+void linx_runtime_start(int* stack_bottom) {
+    tgc_start(&gc, stack_bottom);
+    nursery.stack_bottom = stack_bottom;
+
+    Output__start();
+    atexit(Output__flush);
+
+    len__builtin = Value__create_immortal_fn(&len__builtin_def);
+    type__builtin = Value__create_immortal_fn(&type__builtin_def);
+    range__builtin = Value__create_immortal_fn(&range__builtin_def);
+    toString__builtin = Value__create_immortal_fn(&toString__builtin_def);
+    keys__builtin = Value__create_immortal_fn(&keys__builtin_def);
+    iterator__builtin = Value__create_immortal_fn(&iterator__builtin_def);
+    set__builtin = Value__create_immortal_fn(&set__builtin_def);
+    map__builtin = Value__create_immortal_fn(&map__builtin_def);
+    sort__builtin = Value__create_immortal_fn(&sort__builtin_def);
+    sortBy__builtin = Value__create_immortal_fn(&sortBy__builtin_def);
+
+    parallel__builtin = Value__create_builtin_object(
+        (const char*[]){"map", "reduce"},
+        (fnptr[]){&parallel_map__builtin_def, &parallel_reduce__builtin_def},
+        2);
+    fs__builtin = Value__create_builtin_object(
+        (const char*[]){"readFile", "writeFile", "appendFile", "writer",
+                        "lines", "stat", "exists", "ensure"},
+        (fnptr[]){&fs_readFile__builtin_def, &fs_writeFile__builtin_def,
+                  &fs_appendFile__builtin_def, &fs_writer__builtin_def,
+                  &fs_lines__builtin_def, &fs_stat__builtin_def,
+                  &fs_exists__builtin_def, &fs_ensure__builtin_def},
+        8);
+    lists__builtin = Value__create_builtin_object(
+        (const char*[]){"push", "pop", "concat", "slice", "reverse",
+                        "indexOf", "contains", "join", "map", "filter"},
+        (fnptr[]){&lists_push__builtin_def, &lists_pop__builtin_def,
+                  &lists_concat__builtin_def, &lists_slice__builtin_def,
+                  &lists_reverse__builtin_def, &lists_indexOf__builtin_def,
+                  &lists_contains__builtin_def, &lists_join__builtin_def,
+                  &lists_map__builtin_def, &lists_filter__builtin_def},
+        10);
+
+    iterator_valid_key = Value__intern("valid");
+    iterator_next_key = Value__intern("next");
+
+    // created up front, so threads don't race to create it
+    Shape__empty();
+}
+
+/*
+    runs the program's top level code. locals of `main` may be placed above
+    `argc` on the stack, where they wouldn't be scanned, so the program is
+    run in a frame of its own (the call can't be inlined into `main`).
+*/
+void linx_runtime_run(void (*program)()) {
+    void (*volatile run)() = program;
+    run();
+}
+
+/*
+    a single line on stderr, read by `linx bench`. the nursery's count
+    includes the values in the block that's currently being filled.
+*/
+void linx_runtime_print_stats() {
+    size_t values = nursery.allocated;
+    if (nursery.end != NULL) {
+        values += nursery.next - nursery.blocks[nursery.current].values;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(stderr,
+            "linx-stats {\"allocations\": %zu, \"values\": %zu, "
+            "\"heap_allocations\": %zu, \"heap_bytes\": %zu, "
+            "\"collections\": %zu, \"peak_rss_kb\": %ld}\n",
+            values + heap_stats.allocations, values, heap_stats.allocations,
+            heap_stats.bytes, nursery.collections, usage.ru_maxrss);
+}
+
+#ifdef LINX_PROFILE
+void Profile__summary(FILE* file) {
+    fprintf(file, "allocations:\n");
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        if (profile.allocations[type] == 0) continue;
+        fprintf(file, "  %-10s %12zu calls %14zu bytes\n",
+                type_to_string(type), profile.allocations[type],
+                profile.bytes[type]);
+    }
+    fprintf(file, "  %-10s %12zu calls %14zu bytes\n", "root",
+            profile.root_allocations, profile.root_bytes);
+
+    fprintf(file, "calls:\n");
+    for (ProfileCounter* counter = profile.calls; counter != NULL;
+         counter = counter->next) {
+        fprintf(file, "  %-32s %12zu\n", counter->name, counter->count);
+    }
+
+    fprintf(file, "object lookups (keys compared):\n");
+    for (int i = 0; i < PROFILE_PROBE_BUCKETS; i++) {
+        fprintf(file, "  %d%s %12zu\n", i,
+                i == PROFILE_PROBE_BUCKETS - 1 ? "+" : " ", profile.probes[i]);
+    }
+    fprintf(file, "  inline cache hits %zu, misses %zu\n", profile.cache_hits,
+            profile.cache_misses);
+
+    fprintf(file, "copies:\n");
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        fprintf(file, "  %-10s %12zu\n", type_to_string(type),
+                profile.copies[type]);
+    }
+    fprintf(file, "  %zu shared lists & objects cloned, %zu bytes\n",
+            profile.clones, profile.clone_bytes);
+
+    fprintf(file, "nursery collections: %zu\n", nursery.collections);
+}
+
+void Profile__json(FILE* file) {
+    fprintf(file, "{\n  \"allocations\": {");
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        fprintf(file, "\"%s\": {\"calls\": %zu, \"bytes\": %zu}, ",
+                type_to_string(type), profile.allocations[type],
+                profile.bytes[type]);
+    }
+    fprintf(file, "\"root\": {\"calls\": %zu, \"bytes\": %zu}},\n",
+            profile.root_allocations, profile.root_bytes);
+
+    fprintf(file, "  \"calls\": {");
+    for (ProfileCounter* counter = profile.calls; counter != NULL;
+         counter = counter->next) {
+        fprintf(file, "\"%s\": %zu%s", counter->name, counter->count,
+                counter->next != NULL ? ", " : "");
+    }
+    fprintf(file, "},\n");
+
+    fprintf(file, "  \"probes\": [");
+    for (int i = 0; i < PROFILE_PROBE_BUCKETS; i++) {
+        fprintf(file, "%zu%s", profile.probes[i],
+                i < PROFILE_PROBE_BUCKETS - 1 ? ", " : "");
+    }
+    fprintf(file, "],\n  \"cache_hits\": %zu,\n  \"cache_misses\": %zu,\n",
+            profile.cache_hits, profile.cache_misses);
+
+    fprintf(file, "  \"copies\": {");
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        fprintf(file, "\"%s\": %zu%s", type_to_string(type),
+                profile.copies[type], type < TYPE_COUNT - 1 ? ", " : "");
+    }
+    fprintf(file, "},\n  \"clones\": %zu,\n  \"clone_bytes\": %zu,\n",
+            profile.clones, profile.clone_bytes);
+
+    fprintf(file, "  \"collections\": %zu\n}\n", nursery.collections);
+}
+
+// the format read by flamegraph.pl, weighted by number of calls
+void Profile__folded(FILE* file) {
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        if (profile.allocations[type] == 0) continue;
+        fprintf(file, "linx;allocations;%s %zu\n", type_to_string(type),
+                profile.allocations[type]);
+    }
+    for (ProfileCounter* counter = profile.calls; counter != NULL;
+         counter = counter->next) {
+        fprintf(file, "linx;calls;%s %zu\n", counter->name, counter->count);
+    }
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        if (profile.copies[type] == 0) continue;
+        fprintf(file, "linx;copies;%s %zu\n", type_to_string(type),
+                profile.copies[type]);
+    }
+}
+
+/*
+    `LINX_PROFILE=1` prints a summary to stderr, a path ending in `.json`
+    gets a json report & any other path a flamegraph compatible one.
+*/
+void Profile__report(const char* destination) {
+    if (strcmp(destination, "1") == 0 || destination[0] == '\0') {
+        Profile__summary(stderr);
+        return;
+    }
+
+    FILE* file = fopen(destination, "w");
+    if (file == NULL) {
+        fprintf(stderr, "linx: couldn't write the profile to '%s'\n",
+                destination);
+        return;
+    }
+
+    size_t length = strlen(destination);
+    if (length >= 5 && strcmp(destination + length - 5, ".json") == 0) {
+        Profile__json(file);
+    } else {
+        Profile__folded(file);
+    }
+    fclose(file);
+}
+#endif
+
+void linx_runtime_stop() {
+    // tgc frees the buffer, so nothing's left for `atexit` to flush
+    Output__flush();
+    output = NULL;
+
+    if (getenv("LINX_STATS") != NULL) linx_runtime_print_stats();
+#ifdef LINX_PROFILE
+    if (getenv("LINX_PROFILE") != NULL) Profile__report(getenv("LINX_PROFILE"));
+#endif
+    tgc_stop(&gc);
+}
@@ -1,34 +1,25 @@
+#ifndef LINX_RUNTIME_H
+#define LINX_RUNTIME_H
+
+/*
+    the C runtime's interface: the types & functions generated code uses,
+    plus inline fast paths. the rest is defined in `runtime.c`, which is
+    built once into the `libLinxRuntime` library that programs link with.
+*/
+
 #include <malloc.h>
+#include <math.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #include "gc.h"
 
-/*
-    alias the GCs malloc function to allow for easily
-    switching between GCs and trying different ones.
-*/
-static tgc_t gc;
-static inline void* linx_malloc(size_t size) { return tgc_alloc(&gc, size); }
-
-void string_concat(char** old, const char* to_add) {
-    size_t old_length = strlen(*old) + 1;
-    char* old_copy = linx_malloc(old_length);
-    strcpy(old_copy, *old);
-
-    *old = linx_malloc(old_length + strlen(to_add) + 1);
-    strcpy(*old, old_copy);
-    strcat(*old, to_add);
-}
-
-char* double_to_charptr(double num) {
-    int length = snprintf(NULL, 0, "%g", num);
-    char* str = linx_malloc(length + 1);
-    snprintf(str, length + 1, "%g", num);
-    return str;
-}
-
 typedef enum {
     TYPE_NIL,
     TYPE_BOOLEAN,
@@ -39,800 +30,563 @@ typedef enum {
     TYPE_FUNCTION
 } Type;
 
-typedef struct {
-    Type type;
-    void* raw;
-} Value;
-
-// list
-typedef struct {
-    size_t capacity;
-    size_t length;
-    Value** arr;
-} List;
+#define TYPE_COUNT (TYPE_FUNCTION + 1)
 
-// object
-typedef struct {
-    List* keys;
-    List* values;
-} Object;
+/*
+    opt-in instrumentation. it's compiled in with `-DLINX_PROFILE` (what
+    `linx compile --profile` does) & reported on exit when the `LINX_PROFILE`
+    environment variable is set (see `Profile__report`).
+*/
+#define PROFILE_PROBE_BUCKETS 8
 
-// functions
-typedef Value* (*fnptr)(Value**, Value**);
+#ifdef LINX_PROFILE
+typedef struct ProfileCounter {
+    const char* name;
+    size_t count;
+    struct ProfileCounter* next;
+} ProfileCounter;
 
 typedef struct {
-    fnptr call;
-    Value** environment;
-    size_t environment_length;
-} Function;
-
-void Value__copy(Value* lhs, Value* rhs) {
-    lhs->type = rhs->type;
-
-    switch (rhs->type) {
-        case TYPE_NIL: {
-            lhs->raw = NULL;
-            break;
-        }
-        case TYPE_BOOLEAN: {
-            lhs->raw = linx_malloc(sizeof(bool));
-            *(bool*)lhs->raw = *(bool*)rhs->raw;
-            break;
-        }
-        case TYPE_NUMBER: {
-            lhs->raw = linx_malloc(sizeof(double));
-            *(double*)lhs->raw = *(double*)rhs->raw;
-            break;
-        }
-        case TYPE_STRING: {
-            lhs->raw = linx_malloc(sizeof(char*));
-            *(char**)lhs->raw = linx_malloc(strlen(*(char**)rhs->raw) + 1);
-            strcpy(*(char**)lhs->raw, *(char**)rhs->raw);
-            break;
-        }
-        case TYPE_LIST: {
-            lhs->raw = linx_malloc(sizeof(List));
-            ((List*)lhs->raw)->capacity = ((List*)rhs->raw)->capacity;
-            ((List*)lhs->raw)->length = ((List*)rhs->raw)->length;
-
-            ((List*)lhs->raw)->arr =
-                linx_malloc(sizeof(Value*) * ((List*)rhs->raw)->length);
-
-            for (size_t i = 0; i < ((List*)rhs->raw)->length; i++) {
-                ((List*)lhs->raw)->arr[i] = linx_malloc(sizeof(Value));
-                Value__copy(((List*)lhs->raw)->arr[i],
-                            ((List*)rhs->raw)->arr[i]);
-            }
-
-            break;
-        }
-        case TYPE_OBJECT: {
-            lhs->raw = linx_malloc(sizeof(Object));
-            ((Object*)lhs->raw)->keys = linx_malloc(sizeof(List));
-            ((Object*)lhs->raw)->values = linx_malloc(sizeof(List));
-
-            ((Object*)lhs->raw)->keys->capacity =
-                ((Object*)rhs->raw)->keys->capacity;
-            ((Object*)lhs->raw)->values->capacity =
-                ((Object*)rhs->raw)->values->capacity;
-            ((Object*)lhs->raw)->keys->length =
-                ((Object*)rhs->raw)->keys->length;
-            ((Object*)lhs->raw)->values->length =
-                ((Object*)rhs->raw)->values->length;
-
-            ((Object*)lhs->raw)->keys->arr =
-                linx_malloc(sizeof(Value*) * ((Object*)lhs->raw)->keys->length);
-            ((Object*)lhs->raw)->values->arr = linx_malloc(
-                sizeof(Value*) * ((Object*)lhs->raw)->values->length);
-
-            for (size_t i = 0; i < ((Object*)rhs->raw)->keys->length; i++) {
-                ((Object*)lhs->raw)->keys->arr[i] = linx_malloc(sizeof(Value));
-                Value__copy(((Object*)lhs->raw)->keys->arr[i],
-                            ((Object*)rhs->raw)->keys->arr[i]);
-                ((Object*)lhs->raw)->values->arr[i] =
-                    linx_malloc(sizeof(Value));
-                Value__copy(((Object*)lhs->raw)->values->arr[i],
-                            ((Object*)rhs->raw)->values->arr[i]);
-            }
-
-            break;
-        }
-        case TYPE_FUNCTION: {
-            lhs->raw = linx_malloc(sizeof(Function));
-            ((Function*)lhs->raw)->call = ((Function*)rhs->raw)->call;
-            ((Function*)lhs->raw)->environment_length =
-                ((Function*)rhs->raw)->environment_length;
-            ((Function*)lhs->raw)->environment = linx_malloc(
-                sizeof(Value*) * ((Function*)rhs->raw)->environment_length);
-
-            if (((Function*)rhs->raw)->environment_length > 0) {
-                for (size_t i = 0;
-                     i < ((Function*)rhs->raw)->environment_length; i++) {
-                    ((Function*)lhs->raw)->environment[i] =
-                        ((Function*)rhs->raw)->environment[i];
-                }
-            } else
-                ((Function*)lhs->raw)->environment = NULL;
-
-            break;
-        }
+    // heap allocations by the type of value they're for
+    size_t allocations[TYPE_COUNT];
+    size_t bytes[TYPE_COUNT];
+    size_t root_allocations;
+    size_t root_bytes;
+
+    // every counted function that's been called (see `PROFILE_CALL`)
+    ProfileCounter* calls;
+
+    // keys compared by each object lookup, the last bucket counts the rest
+    size_t probes[PROFILE_PROBE_BUCKETS];
+    size_t cache_hits;
+    size_t cache_misses;
+
+    // `Value__copy` by type, & shared lists or objects that were cloned
+    size_t copies[TYPE_COUNT];
+    size_t clones;
+    size_t clone_bytes;
+} Profile;
+
+extern Profile profile;
+
+#define PROFILE(code) code
+
+// counts the calls to the function it's used in
+#define PROFILE_CALL()                                           \
+    static ProfileCounter profile_counter = {__func__, 0, NULL}; \
+    if (profile_counter.count++ == 0) {                          \
+        profile_counter.next = profile.calls;                    \
+        profile.calls = &profile_counter;                        \
     }
-}
+#else
+#define PROFILE(code)
+#define PROFILE_CALL()
+#endif
 
-Value* Value__create_nil() {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_NIL;
-    result->raw = NULL;
-    return result;
-}
+/*
+    alias the GCs malloc function to allow for easily
+    switching between GCs and trying different ones.
+*/
+extern tgc_t gc;
 
-Value* Value__from_value(Value* value) {
-    Value* result = Value__create_nil();
-    Value__copy(result, value);
+/*
+    the runtime is single threaded, except while `parallel.map` or
+    `parallel.reduce` run (see the thread pool in runtime.c). while they
+    do, tgc & the few other structures every thread shares are guarded by
+    locks, & every thread allocates its values in a nursery of its own.
+*/
+extern bool linx_threads_active;
+extern pthread_mutex_t linx_heap_lock;
+
+#define LINX_LOCK(lock)                                      \
+    do {                                                     \
+        if (linx_threads_active) pthread_mutex_lock(&lock);  \
+    } while (0)
+#define LINX_UNLOCK(lock)                                     \
+    do {                                                      \
+        if (linx_threads_active) pthread_mutex_unlock(&lock); \
+    } while (0)
+
+/*
+    the `shared` flag of a list or object is set by whichever thread copies
+    it, so while a job runs several threads can set the same one at once.
+    the flag only ever goes from false to true (a mutation clones the
+    payload instead of clearing it), relaxed atomics are enough for that.
+    checking first keeps threads from writing to a cache line they share.
+*/
+#define LINX_SHARED(payload) \
+    __atomic_load_n(&(payload)->shared, __ATOMIC_RELAXED)
+#define LINX_SHARE(payload)                                               \
+    do {                                                                  \
+        if (!LINX_SHARED(payload))                                        \
+            __atomic_store_n(&(payload)->shared, true, __ATOMIC_RELAXED); \
+    } while (0)
+
+// reported on exit when `LINX_STATS` is set (see `linx_runtime_stop`)
+typedef struct {
+    size_t allocations;
+    size_t bytes;
+} HeapStats;
+
+extern HeapStats heap_stats;
+
+// `type` is the type of the value the memory is for, used by the profiler
+static inline void* linx_malloc(Type type, size_t size) {
+    LINX_LOCK(linx_heap_lock);
+    heap_stats.allocations++;
+    heap_stats.bytes += size;
+    PROFILE(profile.allocations[type]++; profile.bytes[type] += size);
+    void* result = tgc_alloc(&gc, size);
+    LINX_UNLOCK(linx_heap_lock);
     return result;
 }
-
-bool Value__equals(Value* lhs, Value* rhs) {
-    if (lhs->type != rhs->type) return false;
-
-    switch (lhs->type) {
-        case TYPE_NIL: {
-            // nil is always equal to nil
-            return true;
-        }
-        case TYPE_BOOLEAN: {
-            return *(bool*)lhs->raw == *(bool*)rhs->raw;
-        }
-        case TYPE_NUMBER: {
-            return *(double*)lhs->raw == *(double*)rhs->raw;
-        }
-        case TYPE_STRING: {
-            return strcmp(*(char**)lhs->raw, *(char**)rhs->raw) == 0;
-        }
-        case TYPE_LIST: {
-            if (((List*)lhs->raw)->length != ((List*)rhs->raw)->length)
-                return false;
-
-            for (size_t i = 0; i < ((List*)lhs->raw)->length; i++) {
-                if (!Value__equals(((List*)lhs->raw)->arr[i],
-                                   ((List*)rhs->raw)->arr[i])) {
-                    return false;
-                }
-            }
-
-            return true;
-        }
-        case TYPE_OBJECT: {
-            // TODO: check for deep equality
-            return false;
-        }
-        case TYPE_FUNCTION: {
-            // functions are only equal if they reference the same object
-            return (Function*)lhs->raw == (Function*)rhs->raw;
-        }
-    }
+static inline void* linx_realloc(Type type, void* ptr, size_t size) {
+    LINX_LOCK(linx_heap_lock);
+    PROFILE(profile.allocations[type]++; profile.bytes[type] += size);
+    void* result = tgc_realloc(&gc, ptr, size);
+    LINX_UNLOCK(linx_heap_lock);
+    return result;
 }
 
-List* List__create() {
-    List* result = linx_malloc(sizeof(List));
-    result->capacity = 8;
-    result->length = 0;
-    result->arr = linx_malloc(8 * sizeof(Value));
+// allocations that are never collected (e.g. reachable from static globals)
+static inline void* linx_malloc_root(size_t size) {
+    LINX_LOCK(linx_heap_lock);
+    PROFILE(profile.root_allocations++; profile.root_bytes += size);
+    void* result = tgc_alloc_opt(&gc, size, TGC_ROOT, NULL);
+    LINX_UNLOCK(linx_heap_lock);
     return result;
 }
 
-void List__grow(List* list) {
-    // if capacity is not enough for one more element
-    if (list->capacity < list->length + 1) {
-        size_t old_capacity = list->capacity;
-        Value** old_arr = list->arr;
-
-        list->capacity *= 2;
-        list->arr = linx_malloc(list->capacity * sizeof(Value*));
-        for (size_t i = 0; i < old_capacity; i++) {
-            Value__copy(list->arr[i], old_arr[i]);
-        }
-    }
+static inline void linx_free(void* ptr) {
+    LINX_LOCK(linx_heap_lock);
+    tgc_free(&gc, ptr);
+    LINX_UNLOCK(linx_heap_lock);
 }
 
-void List__append(List* list, Value* value) {
-    List__grow(list);
-    list->length++;
-    list->arr[list->length - 1] = linx_malloc(sizeof(Value));
-    Value__copy(list->arr[list->length - 1], value);
-}
+/*
+    growable character storage, also used on its own as a string builder.
+    the contents are kept NUL terminated.
+*/
+typedef struct {
+    size_t length;
+    size_t capacity;  // excluding the NUL terminator
+    char* chars;
+} StringBuffer;
 
-Value* Function__call(Function* fn, Value** arguments) {
-    return fn->call(fn->environment, arguments);
-}
+/*
+    strings are immutable, which lets values share them instead of copying.
 
-Function* Function__create(fnptr fn, Value** environment,
-                           size_t environment_length) {
-    Function* result = linx_malloc(sizeof(Function));
-    result->call = fn;
-
-    if (environment_length > 0) {
-        result->environment = linx_malloc(sizeof(Value*) * environment_length);
-        result->environment_length = environment_length;
-        for (size_t i = 0; i < environment_length; i++) {
-            /*
-                copying addresses instead of value because
-                closures capture by reference.
-            */
-            result->environment[i] = environment[i];
-        }
-    } else {
-        result->environment = NULL;
-    }
+    a string created by appending to another one may share its buffer: if
+    the string being appended to ends exactly where its buffer's contents
+    end, the new characters are written into the spare capacity & the
+    result is just a longer view of the same buffer. this makes loops like
+    `result = result + x` amortized O(1) per append instead of quadratic.
+*/
+typedef struct {
+    size_t length;
+    size_t hash;  // 0 until it's first needed
+    bool interned;
+    StringBuffer* buffer;  // `NULL` if the characters can't be appended to
+    char* chars;           // not necessarily NUL terminated at `length`
+} String;
 
-    return result;
-}
+/*
+    numbers, booleans & nil are stored inline in the value itself,
+    only strings, lists, objects & functions point to a heap payload.
+*/
+typedef struct {
+    Type type;
+    union {
+        bool boolean;
+        double number;
+        void* raw;
+    } as;
+} Value;
 
-Value* Value__from_bool(bool value) {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_BOOLEAN;
-    result->raw = linx_malloc(sizeof(bool));
-    *(bool*)result->raw = value;
-    return result;
-}
+/*
+    nursery for short lived values. most values are temporaries (operator
+    results, literals, arguments) that die right after they're used, so
+    instead of registering every one of them with tgc they're bump
+    allocated out of fixed size blocks.
+
+    once every block is full a minor collection conservatively scans the
+    stack, the same way tgc does. blocks that something on the stack still
+    points into are pinned & kept as they are (tgc doesn't move objects so
+    survivors can't be promoted by copying them out), every other block
+    is cleared & reused.
+
+    this is only sound for values that nothing on the heap points to,
+    anything that has to outlive its call (e.g. variables captured by a
+    closure) is allocated with `Value__create_cell` instead.
+
+    every thread has a nursery of its own, which only scans its own stack.
+*/
+#ifndef NURSERY_BLOCK_VALUES
+#define NURSERY_BLOCK_VALUES 4096
+#endif
+#ifndef NURSERY_INITIAL_BLOCKS
+#define NURSERY_INITIAL_BLOCKS 16
+#endif
 
-Value* Value__from_double(double value) {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_NUMBER;
-    result->raw = linx_malloc(sizeof(double));
-    *(double*)result->raw = value;
-    return result;
-}
+typedef struct {
+    // a root allocation, so tgc keeps whatever the values point to alive
+    Value* values;
+    bool full;
+    bool pinned;
+} NurseryBlock;
 
-Value* Value__from_charptr(const char* str) {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_STRING;
-    result->raw = linx_malloc(sizeof(char**));
-    *(char**)result->raw = linx_malloc(strlen(str) + 1);
-    strcpy(*(char**)result->raw, str);
-    return result;
-}
+typedef struct {
+    NurseryBlock* blocks;
+    size_t blocks_length;
+    size_t blocks_capacity;
 
-Value* Value__create_list() {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_LIST;
-    result->raw = List__create();
-    return result;
-}
+    // bump pointer into the block currently being filled
+    size_t current;
+    Value* next;
+    Value* end;
 
-Value* Value__from_array(Value* arr[], size_t count) {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_LIST;
-    result->raw = linx_malloc(sizeof(List));
+    // every block lies in between these, to quickly skip other pointers
+    char* low;
+    char* high;
 
-    if (count == 0) {
-        result->raw = List__create();
-    } else {
-        ((List*)result->raw)->arr = linx_malloc(count * sizeof(Value*));
-        ((List*)result->raw)->length = count;
-        ((List*)result->raw)->capacity = count;
-        for (size_t i = 0; i < count; i++) {
-            ((List*)result->raw)->arr[i] = linx_malloc(sizeof(Value));
-            Value__copy(((List*)result->raw)->arr[i], arr[i]);
-        }
-    }
+    void* stack_bottom;
+    size_t collections;
 
-    return result;
-}
+    // values allocated in blocks that have since been filled up
+    size_t allocated;
+} Nursery;
 
-Value* Value__create_fn(fnptr fn, Value** environment,
-                        size_t environment_length) {
-    Value* result = Value__create_nil();
-    result->type = TYPE_FUNCTION;
-    result->raw = Function__create(fn, environment, environment_length);
-    return result;
-}
+extern __thread Nursery nursery;
 
-Object* Object__create() {
-    Object* result = linx_malloc(sizeof(Object));
-    result->keys = List__create();
-    result->values = List__create();
-    return result;
-}
+void Nursery__refill();
 
-Value* Value__create_object() {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_OBJECT;
-    result->raw = Object__create();
-    return result;
+static inline Value* Value__alloc() {
+    if (nursery.next == nursery.end) Nursery__refill();
+    return nursery.next++;
 }
 
-Value* Object__get(Object* object, Value* key) {
-    for (size_t i = 0; i < object->keys->length; i++) {
-        if (Value__equals(object->keys->arr[i], key)) {
-            return object->values->arr[i];
-        }
-    }
+/*
+    list elements are stored inline in a single contiguous buffer. since
+    the buffer moves when it grows, pointers to elements must not be kept
+    around, reads hand out copies of the element instead.
+*/
+typedef struct {
+    size_t capacity;
+    size_t length;
+    Value* arr;
 
-    // returns `nil` if key doesn't exist
-    Value* result = Value__create_nil();
-    return result;
-}
+    // set once more than one value refers to the list (see `Value__copy`)
+    bool shared;
 
-void Object__set(Object* object, Value* key, Value* value) {
-    Value* existing = Object__get(object, key);
+    /*
+        lists created by `range` are lazy: their elements are computed from
+        `start` & `step` (`arr` stays empty) until the list is first mutated.
+    */
+    bool range;
+    double start;
+    double step;
+} List;
 
-    // if the object doesn't have the key, the key has to be added
-    if (existing->type == TYPE_NIL) {
-        List__append(object->keys, key);
-        List__append(object->values, value);
+static inline Value List__get(List* list, size_t index) {
+    Value result;
+    if (list->range) {
+        result.type = TYPE_NUMBER;
+        result.as.number = list->start + index * list->step;
     } else {
-        // otherwise update the key
-        Value__copy(existing, value);
+        result = list->arr[index];
     }
-}
-
-Value* Value__create_object_from_arrs(Value** keys, Value** values,
-                                      size_t size) {
-    Value* result = linx_malloc(sizeof(Value));
-    result->type = TYPE_OBJECT;
-    result->raw = Object__create();
-
-    for (size_t i = 0; i < size; i++) {
-        Object__set((Object*)result->raw, keys[i], values[i]);
-    }
-
     return result;
 }
 
-char* Value__to_charptr(Value* value) {
-    switch (value->type) {
-        case TYPE_NIL:
-            return "nil";
-        case TYPE_BOOLEAN:
-            return *(bool*)value->raw ? "true" : "false";
-        case TYPE_NUMBER:
-            return double_to_charptr(*(double*)value->raw);
-        case TYPE_STRING:
-            return *(char**)value->raw;
-        case TYPE_LIST: {
-            char* result = "[";
-            List* list = (List*)value->raw;
-            for (size_t i = 0; i < list->length; i++) {
-                string_concat(&result, Value__to_charptr(list->arr[i]));
-                if (i != list->length - 1) string_concat(&result, ", ");
-            }
-            string_concat(&result, "]");
-            return result;
-        }
-        case TYPE_OBJECT: {
-            char* result = "{";
-            List* keys = ((Object*)value->raw)->keys;
-            List* values = ((Object*)value->raw)->values;
-
-            for (size_t i = 0; i < keys->length; i++) {
-                string_concat(&result, Value__to_charptr(keys->arr[i]));
-                string_concat(&result, ": ");
-                string_concat(&result, Value__to_charptr(values->arr[i]));
-                if (i != keys->length - 1) string_concat(&result, ", ");
-            }
-            string_concat(&result, "}");
-
-            return result;
-        }
-        case TYPE_FUNCTION:
-            return "<function>";
-    }
-}
-
-bool Value__to_bool(Value* value) {
-    // this is where we determine whether values are "falsy" or "truthy"
-    switch (value->type) {
-        case TYPE_NIL:
-            return false;
-        case TYPE_BOOLEAN:
-            return *(bool*)value->raw;
-        case TYPE_NUMBER:
-            return *(double*)value->raw != 0;
-        case TYPE_STRING:
-            return strlen(*(char**)value->raw) != 0;
-        case TYPE_LIST:
-            return ((List*)value->raw)->length != 0;
-        case TYPE_OBJECT:
-            return ((Object*)value->raw)->keys->length != 0;
-        case TYPE_FUNCTION:
-            return true;  // functions are always truthy
-    }
-}
-
-void print(Value* value) { printf("%s\n", Value__to_charptr(value)); }
-
 /*
-    *-----------------*
-    |    Operators    |
-    *-----------------*
+    shapes (hidden classes) describe the ordered key layout of an object.
+    objects that gain the same keys in the same order share a shape, which
+    means a key always lives in the same slot for a given shape. this lets
+    property reads cache a (shape, slot) pair per call site.
 */
+#define SHAPE_MAX_KEYS 32
+#define SHAPE_MAX_TRANSITIONS 64
+
+typedef struct Shape {
+    struct Shape* parent;
+    Value* key;     // the key added by the transition from `parent`
+    size_t length;  // number of keys described by this shape
+    struct Shape** transitions;
+    size_t transitions_length;
+    size_t transitions_capacity;
+} Shape;
 
-/* <-- Logical --> */
+typedef struct {
+    Shape* shape;
+    size_t slot;
+} InlineCache;
 
-// lhs && rhs
-Value* linx__operator_or(Value* lhs, Value* rhs) {
-    return Value__from_bool(Value__to_bool(lhs) || Value__to_bool(rhs));
-}
-// lhs || rhs
-Value* linx__operator_and(Value* lhs, Value* rhs) {
-    return Value__from_bool(Value__to_bool(lhs) && Value__to_bool(rhs));
-}
-// !value
-Value* linx__operator_not(Value* value) {
-    return Value__from_bool(!Value__to_bool(value));
-}
+// objects at or above this many keys are indexed by a hash table
+#define OBJECT_INDEX_THRESHOLD 8
 
-/* <-- Comparisons --> */
+// object
+typedef struct {
+    List* keys;
+    List* values;
 
-// lhs == rhs
-Value* linx__operator_equals(Value* lhs, Value* rhs) {
-    return Value__from_bool(Value__equals(lhs, rhs));
-}
-// lhs != rhs
-Value* linx__operator_nequals(Value* lhs, Value* rhs) {
-    return Value__from_bool(!Value__equals(lhs, rhs));
-}
-// lhs < rhs
-Value* linx__operator_lesser(Value* lhs, Value* rhs) {
-    bool result = false;
-    /*
-        is `[1, 2, 3] < 45`?
+    // `NULL` once the object has left the shape tree (dictionary mode)
+    Shape* shape;
 
-        might revisit this, but for comparisons between values
-        of different types the result is always false
+    /*
+        open addressing (linear probing) table of positions into
+        `keys`/`values`, offset by one so that 0 marks an empty slot.
     */
-    if (lhs->type != rhs->type) return Value__from_bool(false);
-
-    switch (lhs->type) {
-        case TYPE_NIL:
-            result = false;
-            break;
-        case TYPE_BOOLEAN:
-            // false is less than true
-            result = *(bool*)lhs->raw < *(bool*)rhs->raw;
-            break;
-        case TYPE_NUMBER:
-            result = *(double*)lhs->raw < *(double*)rhs->raw;
-            break;
-        case TYPE_STRING:
-            result = *(char**)lhs->raw < *(char**)rhs->raw;
-            break;
-        case TYPE_LIST:
-            result = ((List*)lhs->raw)->length < ((List*)rhs->raw)->length;
-            break;
-        case TYPE_OBJECT:
-            result = ((Object*)lhs->raw)->keys->length <
-                     ((Object*)rhs->raw)->keys->length;
-            break;
-        case TYPE_FUNCTION:
-            result = false;
-            break;
-    }
+    size_t* index;
+    size_t index_capacity;
 
-    return Value__from_bool(result);
-}
-// lhs > rhs
-Value* linx__operator_greater(Value* lhs, Value* rhs) {
-    bool result = false;
-    if (lhs->type != rhs->type) return Value__from_bool(result);
+    // set once more than one value refers to the object (see `Value__copy`)
+    bool shared;
+} Object;
 
-    switch (lhs->type) {
-        case TYPE_NIL:
-            result = false;
-            break;
-        case TYPE_BOOLEAN:
-        case TYPE_NUMBER:
-        case TYPE_STRING:
-        case TYPE_LIST:
-        case TYPE_OBJECT:
-            result = !(Value__to_bool(linx__operator_lesser(lhs, rhs)));
-            break;
-        case TYPE_FUNCTION:
-            result = false;
-            break;
-    }
+// functions
+typedef Value* (*fnptr)(Value**, Value**);
 
-    return Value__from_bool(result);
-}
-// lhs <= rhs
-Value* linx__operator_lequals(Value* lhs, Value* rhs) {
-    return linx__operator_or(linx__operator_lesser(lhs, rhs),
-                             linx__operator_equals(lhs, rhs));
-}
-// lhs >= rhs
-Value* linx__operator_gequals(Value* lhs, Value* rhs) {
-    return linx__operator_or(linx__operator_greater(lhs, rhs),
-                             linx__operator_equals(lhs, rhs));
-}
+/*
+    closures are a single allocation: the environment (pointers to the
+    captured variables) is stored inline, followed by the values that were
+    captured by copy (see `Function__create`).
+*/
+typedef struct {
+    fnptr call;
+    size_t environment_length;
+    Value* environment[];
+} Function;
 
-/* <-- Arithmetic --> */
-
-// lhs + rhs
-Value* linx__operator_add(Value* lhs, Value* rhs) {
-    if (lhs->type == TYPE_STRING || rhs->type == TYPE_STRING) {
-        // implicitly convert to string when dealing with addition to strings
-        Value* result = Value__from_charptr("");
-        string_concat((char**)result->raw, Value__to_charptr(lhs));
-        string_concat((char**)result->raw, Value__to_charptr(rhs));
-        return result;
-    } else if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
-        Value* result =
-            Value__from_double(*(double*)lhs->raw + *(double*)rhs->raw);
-        return result;
-    } else {
-        return Value__create_nil();
-    }
-}
-// lhs - rhs
-Value* linx__operator_subtract(Value* lhs, Value* rhs) {
-    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
-        Value* result =
-            Value__from_double(*(double*)lhs->raw - *(double*)rhs->raw);
-        return result;
-    } else {
-        return Value__create_nil();
-    }
-}
-// lhs * rhs
-Value* linx__operator_multiply(Value* lhs, Value* rhs) {
-    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
-        Value* result =
-            Value__from_double(*(double*)lhs->raw * *(double*)rhs->raw);
-        return result;
-    } else if (lhs->type == TYPE_STRING && rhs->type == TYPE_NUMBER &&
-               *(double*)rhs->raw > 0) {
-        char* result = "";
-        for (size_t i = 0; i < (size_t)(*(double*)rhs->raw); i++) {
-            string_concat(&result, result);
-        }
-        return Value__from_charptr(result);
-    } else {
-        return Value__create_nil();
-    }
-}
-// lhs / rhs
-Value* linx__operator_divide(Value* lhs, Value* rhs) {
-    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
-        Value* result =
-            Value__from_double(*(double*)lhs->raw / *(double*)rhs->raw);
-        return result;
-    } else {
-        return Value__create_nil();
-    }
-}
-// lhs % rhs
-Value* linx__operator_mod(Value* lhs, Value* rhs) {
-    if (lhs->type == TYPE_NUMBER && rhs->type == TYPE_NUMBER) {
-        Value* result = Value__from_double(*(int*)lhs->raw % *(int*)rhs->raw);
-        return result;
-    } else {
-        return Value__create_nil();
-    }
-}
+/*
+    native iteration for `for` loops. instead of calling the closures of an
+    `iterator` object every time around, the loop keeps a cursor into the
+    value being iterated & reads its elements directly. iterator objects
+    (with `valid()` & `next()`) are the exception, their functions are
+    called (`type` is `TYPE_FUNCTION` & `raw` the object).
+*/
+typedef struct {
+    Type type;
+    void* raw;
+    size_t index;
 
-/* <-- Other --> */
+    // used for ranges, which the compiler iterates without creating a list
+    size_t length;
+    double start;
+    double step;
+} Iterator;
 
-// lhs = rhs
-Value* linx__operator_assign(Value* lhs, Value* rhs) {
-    Value__copy(lhs, rhs);
-    return lhs;
-}
+/*
+    the builtins as values, for the generated code to call & pass around.
+    they're created once at startup instead of in every function.
+*/
+extern Value* len__builtin;
+extern Value* type__builtin;
+extern Value* range__builtin;
+extern Value* toString__builtin;
+extern Value* keys__builtin;
+extern Value* iterator__builtin;
+extern Value* set__builtin;
+extern Value* map__builtin;
+extern Value* sort__builtin;
+extern Value* sortBy__builtin;
+extern Value* parallel__builtin;
+extern Value* fs__builtin;
+extern Value* lists__builtin;
 
-// obj.key
-Value* linx__operator_dot(Value* obj, Value* key) {
-    if (obj->type != TYPE_OBJECT) return Value__create_nil();
-    return Object__get((Object*)obj->raw, key);
-}
+/*
+    nil, true & false are immortal singletons rather than allocations.
+    values handed out by operators & builtins are never written to (e.g.
+    `Object__get` returns the object's own slot), so every nil & boolean
+    result can share these. code that writes to a new value gets one of
+    its own from `Value__alloc` (or `Value__from_value`) instead.
+*/
+extern Value linx_nil;
+extern Value linx_true;
+extern Value linx_false;
 
-// arr[idx]
-Value* linx__operator_subscript(Value* arr, Value* idx) {
-    if (arr->type != TYPE_OBJECT && arr->type != TYPE_LIST &&
-        arr->type != TYPE_STRING) {
-        return Value__create_nil();
-    }
+/*
+    the allocators & conversions generated code uses the most, inlined into
+    it instead of being called in the runtime library.
+*/
+static inline Value* Value__create_nil() { return &linx_nil; }
 
-    if (arr->type == TYPE_OBJECT) {
-        if (idx->type != TYPE_STRING) return Value__create_nil();
-        return linx__operator_dot(arr, idx);
-    } else {
-        if (idx->type != TYPE_NUMBER) return Value__create_nil();
-
-        // dealing with a list & a number idx
-        double index = *(double*)idx->raw;
-
-        // TODO: circular indexing would be nice
-        if (index < 0 || index > ((List*)arr->raw)->length - 1 ||
-            (int)index != index) {
-            return Value__create_nil();
-        }
-
-        if (arr->type == TYPE_LIST) {
-            return ((List*)arr->raw)->arr[(int)(*(double*)idx->raw)];
-        } else {
-            char c = (*(char**)arr->raw)[(int)(*(double*)idx->raw)];
-            char tmp[] = {c, '\0'};
-            return Value__from_charptr(tmp);
-        }
-    }
+static inline Value* Value__from_bool(bool value) {
+    return value ? &linx_true : &linx_false;
 }
 
-/* func(...args) */
-Value* linx__operator_call(Value* func, Value** args) {
-    if (func->type == TYPE_FUNCTION) {
-        return Function__call((Function*)func->raw, args);
-    }
-
-    return Value__create_nil();
+static inline Value* Value__from_double(double value) {
+    Value* result = Value__alloc();
+    result->type = TYPE_NUMBER;
+    result->as.number = value;
+    return result;
 }
 
-char* type_to_string(Type t) {
-    switch (t) {
+static inline bool Value__to_bool(Value* value) {
+    // this is where we determine whether values are "falsy" or "truthy"
+    switch (value->type) {
         case TYPE_NIL:
-            return "nil";
+            return false;
         case TYPE_BOOLEAN:
-            return "boolean";
+            return value->as.boolean;
         case TYPE_NUMBER:
-            return "number";
+            return value->as.number != 0;
         case TYPE_STRING:
-            return "string";
+            return ((String*)value->as.raw)->length != 0;
         case TYPE_LIST:
-            return "list";
+            return ((List*)value->as.raw)->length != 0;
         case TYPE_OBJECT:
-            return "object";
-        case TYPE_FUNCTION:
-            return "function";
-    }
-}
-
-Value* len__builtin_def(Value** environment, Value** arguments) {
-    switch (arguments[0]->type) {
-        case TYPE_NIL:
-        case TYPE_BOOLEAN:
-        case TYPE_NUMBER:
+            return ((Object*)value->as.raw)->keys->length != 0;
         case TYPE_FUNCTION:
-            return Value__create_nil();
-        case TYPE_STRING:
-            return Value__from_double(strlen(*(char**)arguments[0]->raw));
-        case TYPE_LIST:
-            return Value__from_double(((List*)arguments[0]->raw)->length);
-        case TYPE_OBJECT:
-            return Value__from_double(
-                ((Object*)arguments[0]->raw)->keys->length);
-    }
-}
-
-Value* type__builtin_def(Value** environment, Value** arguments) {
-    return Value__from_charptr(type_to_string(arguments[0]->type));
-}
-
-Value* range__builtin_def(Value** environment, Value** arguments) {
-    Value* start = arguments[0];
-    Value* end = arguments[1];
-    Value* step = arguments[2];
-
-    if (Value__equals(start, end)) {
-        return Value__create_list();
-    }
-
-    bool forwards = true;
-    if (Value__to_bool(linx__operator_greater(start, end))) forwards = false;
-
-    Value* result = Value__from_array(NULL, 0);
-
-    if (forwards) {
-        while (Value__to_bool(linx__operator_lequals(start, end))) {
-            List__append((List*)result->raw, start);
-            Value__copy(start, linx__operator_add(start, step));
-        }
-    } else {
-        while (Value__to_bool(linx__operator_gequals(start, end))) {
-            List__append((List*)result->raw, start);
-            Value__copy(start, linx__operator_subtract(start, step));
-        }
-    }
-
-    return result;
-}
-
-Value* toString__builtin_def(Value** environment, Value** arguments) {
-    return Value__from_charptr(Value__to_charptr(arguments[0]));
-}
-
-Value* print__builtin_def(Value** environment, Value** arguments) {
-    printf("%s\n", Value__to_charptr(arguments[0]));
-    return Value__create_nil();
-}
-
-Value* keys__builtin_def(Value** environment, Value** arguments) {
-    if (arguments[0]->type == TYPE_OBJECT) {
-        return Value__from_array(((Object*)arguments[0]->raw)->keys->arr,
-                                 ((Object*)arguments[0]->raw)->keys->length);
+            return true;  // functions are always truthy
     }
-
-    return Value__create_nil();
 }
 
-Value* valid4__linx_definition(Value** environment, Value** arguments) {
-    Value* len = Value__create_fn(&len__builtin_def, NULL, 0);
-
-    return linx__operator_lequals(
-        environment[0],
-        linx__operator_subtract(
-            linx__operator_call(len, (Value*[]){environment[1]}),
-            Value__from_double(1)));
-}
-
-Value* next3__linx_definition(Value** environment, Value** arguments) {
-    Value__copy(environment[0],
-                linx__operator_add(environment[0], Value__from_double(1)));
-    return linx__operator_subscript(
-        environment[1],
-        linx__operator_subtract(environment[0], Value__from_double(1)));
-}
-
-Value* valid2__linx_definition(Value** environment, Value** arguments) {
-    Value* len = Value__create_fn(&len__builtin_def, NULL, 0);
-
-    return linx__operator_lequals(
-        environment[0],
-        linx__operator_subtract(
-            linx__operator_call(len, (Value*[]){environment[1]}),
-            Value__from_double(1)));
-}
-
-Value* next1__linx_definition(Value** environment, Value** arguments) {
-    Value__copy(environment[0],
-                linx__operator_add(environment[0], Value__from_double(1)));
-
-    return Value__from_array(
-        (Value*[]){
-            linx__operator_subscript(
-                environment[1],
-                linx__operator_subtract(environment[0], Value__from_double(1))),
-            linx__operator_subscript(
-                environment[2],
-                linx__operator_subscript(
-                    environment[1],
-                    linx__operator_subtract(environment[0],
-                                            Value__from_double(1))))},
-        2);
-}
+// strings
+char* double_to_charptr(double num);
+StringBuffer* StringBuffer__create(size_t capacity);
+void StringBuffer__reserve(StringBuffer* buffer, size_t capacity);
+void StringBuffer__append(StringBuffer* buffer, const char* chars,
+                          size_t length);
+void StringBuffer__append_charptr(StringBuffer* buffer, const char* chars);
+String* String__from_buffer(StringBuffer* buffer);
+String* String__create(const char* chars, size_t length);
+String* String__append(String* lhs, const char* chars, size_t length);
+String* String__concat(String* lhs, String* rhs);
+char* String__to_charptr(String* str);
+String* String__map_file(const char* path);
+size_t String__hash(String* str);
+bool String__equals(String* lhs, String* rhs);
+int String__compare(String* lhs, String* rhs);
+String* String__intern(const char* chars, size_t length);
+void StringBuffer__append_value(StringBuffer* buffer, Value* value);
+
+// values
+void Value__copy(Value* lhs, Value* rhs);
+Value* Value__from_value(Value* value);
+Value* Value__create_cell(Value* value);
+bool Value__equals(Value* lhs, Value* rhs);
+size_t Value__hash(Value* value);
+Value* Value__from_string(String* str);
+Value* Value__from_charptr(const char* str);
+Value* Value__intern(const char* str);
+Value* Value__create_list();
+Value* Value__from_array(Value* arr[], size_t count);
+Value* Value__create_fn(fnptr fn, Value** environment,
+                        size_t environment_length, size_t values_length);
+Value* Value__create_object();
+Value* Value__create_object_from_arrs(Value** keys, Value** values,
+                                      size_t size);
+
+// lists
+List* List__create();
+size_t Range__length(double start, double end, double step);
+List* List__create_range(double start, double step, size_t length);
+void List__reserve(List* list, size_t capacity);
+void List__grow(List* list);
+void List__append(List* list, Value* value);
+void List__append_range(List* list, List* other, size_t start,
+                        size_t length);
+void List__append_all(List* list, List* other);
+void List__materialize(List* list);
+List* List__clone(List* list);
+List* Value__mutable_list(Value* value);
 
-Value* iterator__builtin_def(Value** environment, Value** arguments) {
-    Value* type = Value__create_fn(&type__builtin_def, NULL, 0);
-    Value* keys = Value__create_fn(&keys__builtin_def, NULL, 0);
-
-    Value* value = arguments[0];
-    Value* t = Value__create_nil();
-    Value__copy(t, linx__operator_call(type, (Value*[]){value}));
-    if (Value__to_bool(
-            linx__operator_equals(t, Value__from_charptr("object")))) {
-        Value* index = Value__create_nil();
-        Value__copy(index, Value__from_double(0));
-        Value* objKeys = Value__create_nil();
-        Value__copy(objKeys, linx__operator_call(keys, (Value*[]){value}));
-        Value* next = Value__create_fn(&next1__linx_definition,
-                                       (Value*[]){index, objKeys, value}, 3);
-        Value* valid = Value__create_fn(&valid2__linx_definition,
-                                        (Value*[]){index, value}, 2);
-        return Value__create_object_from_arrs(
-            (Value*[]){Value__from_charptr("next"),
-                       Value__from_charptr("valid")},
-            (Value*[]){next, valid}, 2);
-    }
-    if (Value__to_bool(linx__operator_or(
-            linx__operator_equals(t, Value__from_charptr("list")),
-            linx__operator_equals(t, Value__from_charptr("string"))))) {
-        Value* index = Value__create_nil();
-        Value__copy(index, Value__from_double(0));
-        Value* next = Value__create_fn(&next3__linx_definition,
-                                       (Value*[]){index, value}, 2);
-        Value* valid = Value__create_fn(&valid4__linx_definition,
-                                        (Value*[]){index, value}, 2);
-        return Value__create_object_from_arrs(
-            (Value*[]){Value__from_charptr("next"),
-                       Value__from_charptr("valid")},
-            (Value*[]){next, valid}, 2);
-    }
-}
+// functions
+Value* Function__call(Function* fn, Value** arguments);
+Function* Function__create(fnptr fn, Value** environment,
+                           size_t environment_length, size_t values_length);
+
+// objects
+Shape* Shape__create(Shape* parent, Value* key);
+Shape* Shape__empty();
+Shape* Shape__transition(Shape* shape, Value* key);
+Object* Object__create();
+Object* Object__clone(Object* object);
+Object* Value__mutable_object(Value* value);
+long Object__find(Object* object, Value* key);
+Value* Object__get(Object* object, Value* key);
+void Object__set(Object* object, Value* key, Value* value);
+bool Object__remove(Object* object, Value* key);
+
+// conversions
+char* Value__to_charptr(Value* value);
+String* Value__to_string(Value* value);
+void print(Value* value);
+void Output__start();
+void Output__flush();
+char* type_to_string(Type t);
+
+// operators
+Value* linx__operator_or(Value* lhs, Value* rhs);
+Value* linx__operator_and(Value* lhs, Value* rhs);
+Value* linx__operator_not(Value* value);
+Value* linx__operator_equals(Value* lhs, Value* rhs);
+Value* linx__operator_nequals(Value* lhs, Value* rhs);
+Value* linx__operator_lesser(Value* lhs, Value* rhs);
+Value* linx__operator_greater(Value* lhs, Value* rhs);
+Value* linx__operator_lequals(Value* lhs, Value* rhs);
+Value* linx__operator_gequals(Value* lhs, Value* rhs);
+Value* linx__operator_add(Value* lhs, Value* rhs);
+Value* linx__operator_subtract(Value* lhs, Value* rhs);
+Value* linx__operator_multiply(Value* lhs, Value* rhs);
+Value* linx__operator_divide(Value* lhs, Value* rhs);
+Value* linx__operator_mod(Value* lhs, Value* rhs);
+Value* linx__operator_negate(Value* value);
+Value* linx__operator_assign(Value* lhs, Value* rhs);
+Value* linx__operator_dot(Value* obj, Value* key);
+Value* linx__operator_dot_cached(Value* obj, Value* key, InlineCache* cache);
+Value* linx__operator_subscript(Value* arr, Value* idx);
+Value* linx__operator_dot_mut(Value* obj, Value* key);
+Value* linx__operator_subscript_mut(Value* arr, Value* idx);
+Value* linx__operator_dot_assign(Value* obj, Value* key, Value* value);
+Value* linx__operator_subscript_assign(Value* arr, Value* idx, Value* value);
+Value* linx__operator_call(Value* func, Value** args);
+
+// builtins
+Value* len__builtin_def(Value** environment, Value** arguments);
+Value* type__builtin_def(Value** environment, Value** arguments);
+Value* range__builtin_def(Value** environment, Value** arguments);
+Value* toString__builtin_def(Value** environment, Value** arguments);
+Value* print__builtin_def(Value** environment, Value** arguments);
+Value* keys__builtin_def(Value** environment, Value** arguments);
+Value* iterator__builtin_def(Value** environment, Value** arguments);
+Value* set__builtin_def(Value** environment, Value** arguments);
+Value* map__builtin_def(Value** environment, Value** arguments);
+Value* sort__builtin_def(Value** environment, Value** arguments);
+Value* sortBy__builtin_def(Value** environment, Value** arguments);
+Value* parallel_map__builtin_def(Value** environment, Value** arguments);
+Value* parallel_reduce__builtin_def(Value** environment, Value** arguments);
+Value* fs_readFile__builtin_def(Value** environment, Value** arguments);
+Value* fs_writeFile__builtin_def(Value** environment, Value** arguments);
+Value* fs_appendFile__builtin_def(Value** environment, Value** arguments);
+Value* fs_writer__builtin_def(Value** environment, Value** arguments);
+Value* fs_lines__builtin_def(Value** environment, Value** arguments);
+Value* fs_stat__builtin_def(Value** environment, Value** arguments);
+Value* fs_exists__builtin_def(Value** environment, Value** arguments);
+Value* fs_ensure__builtin_def(Value** environment, Value** arguments);
+Value* lists_push__builtin_def(Value** environment, Value** arguments);
+Value* lists_pop__builtin_def(Value** environment, Value** arguments);
+Value* lists_concat__builtin_def(Value** environment, Value** arguments);
+Value* lists_slice__builtin_def(Value** environment, Value** arguments);
+Value* lists_reverse__builtin_def(Value** environment, Value** arguments);
+Value* lists_indexOf__builtin_def(Value** environment, Value** arguments);
+Value* lists_contains__builtin_def(Value** environment, Value** arguments);
+Value* lists_join__builtin_def(Value** environment, Value** arguments);
+Value* lists_map__builtin_def(Value** environment, Value** arguments);
+Value* lists_filter__builtin_def(Value** environment, Value** arguments);
+Value* Value__create_immortal_fn(fnptr fn);
+Value* Value__create_builtin_object(const char** names, fnptr* fns,
+                                    size_t length);
+
+// iteration
+Iterator Iterator__create(Value* value);
+Iterator Iterator__range(Value* start, Value* end, Value* step);
+bool Iterator__valid(Iterator* iter);
+Value* Iterator__next(Iterator* iter);
+
+// running programs
+void linx_runtime_start(int* stack_bottom);
+void linx_runtime_run(void (*program)());
+void linx_runtime_stop();
+
+#endif
@@ -14,7 +14,11 @@ function type(value) {
 }
 
 function len(value) {
-	if (type(value) !== 'object' && type(value) !== 'list') {
+	if (
+		type(value) !== 'object' &&
+		type(value) !== 'list' &&
+		type(value) !== 'string'
+	) {
 		return null
 	}
 
@@ -70,6 +74,430 @@ function keys(value) {
 	} else return null
 }
 
+// lists & objects are equal if their contents are, like in the C runtime
+function linx__equals(lhs, rhs) {
+	if (lhs === rhs) return true
+	if (type(lhs) !== type(rhs)) return false
+
+	switch (type(lhs)) {
+		case 'list':
+			return (
+				lhs.length === rhs.length &&
+				lhs.every((element, i) => linx__equals(element, rhs[i]))
+			)
+		case 'object': {
+			// the same pairs, in any order
+			const keys = Object.keys(lhs)
+			return (
+				keys.length === Object.keys(rhs).length &&
+				keys.every(
+					(key) =>
+						Object.prototype.hasOwnProperty.call(rhs, key) &&
+						linx__equals(lhs[key], rhs[key])
+				)
+			)
+		}
+		default:
+			return false
+	}
+}
+
+/*
+	`set` & `map` find keys by their contents like the C runtime, by a
+	string that's the same for equal values. pairs are kept in order &
+	removed by moving the last pair into their place, the same as the C
+	runtime's tables, so both list them in the same order.
+*/
+const linx__functionIds = new WeakMap()
+
+function linx__key(value) {
+	switch (type(value)) {
+		case 'nil':
+		case 'boolean':
+			return String(value)
+		case 'number':
+			return 'n' + value
+		case 'string':
+			return JSON.stringify(value)
+		case 'list':
+			return '[' + value.map(linx__key).join(',') + ']'
+		case 'object':
+			return (
+				'{' +
+				Object.keys(value)
+					.sort()
+					.map((key) => JSON.stringify(key) + ':' + linx__key(value[key]))
+					.join(',') +
+				'}'
+			)
+		case 'function':
+			if (!linx__functionIds.has(value)) {
+				linx__functionIds.set(value, linx__functionIds.size)
+			}
+			return 'f' + linx__functionIds.get(value)
+	}
+}
+
+function linx__table() {
+	let keys = []
+	let values = []
+	let positions = new Map()
+
+	return {
+		keys,
+		values,
+		find: (key) => positions.get(linx__key(key)),
+		add(key, value) {
+			const hash = linx__key(key)
+			if (positions.has(hash)) return false
+
+			positions.set(hash, keys.length)
+			keys.push(key)
+			values.push(value)
+			return true
+		},
+		set(key, value) {
+			const position = positions.get(linx__key(key))
+			if (position === undefined) this.add(key, value)
+			else values[position] = value
+		},
+		remove(key) {
+			const hash = linx__key(key)
+			const position = positions.get(hash)
+			if (position === undefined) return false
+
+			const last = keys.length - 1
+			positions.delete(hash)
+			if (position !== last) {
+				positions.set(linx__key(keys[last]), position)
+				keys[position] = keys[last]
+				values[position] = values[last]
+			}
+			keys.pop()
+			values.pop()
+			return true
+		},
+	}
+}
+
+function set(list) {
+	if (type(list) !== 'list') return null
+
+	let table = linx__table()
+	list.forEach((value) => table.add(value, true))
+
+	return {
+		add: (value) => table.add(value, true),
+		has: (value) => table.find(value) !== undefined,
+		remove: (value) => table.remove(value),
+		size: () => table.keys.length,
+		values: () => [...table.keys],
+	}
+}
+
+function map(object) {
+	if (type(object) !== 'object') return null
+
+	let table = linx__table()
+	Object.keys(object).forEach((key) => table.add(key, object[key]))
+
+	return {
+		get(key) {
+			const position = table.find(key)
+			return position === undefined ? null : table.values[position]
+		},
+		set(key, value) {
+			table.set(key, value)
+			return value
+		},
+		has: (key) => table.find(key) !== undefined,
+		remove: (key) => table.remove(key),
+		size: () => table.keys.length,
+		keys: () => [...table.keys],
+		values: () => [...table.values],
+	}
+}
+
+/*
+	the default order of `sort`, the same as `<` for values of the same
+	type & otherwise by type, like the C runtime's. JS's sort is stable too.
+*/
+const linx__typeOrder = [
+	'nil',
+	'boolean',
+	'number',
+	'string',
+	'list',
+	'object',
+	'function',
+]
+
+function linx__compare(lhs, rhs) {
+	const lhsType = type(lhs)
+	const rhsType = type(rhs)
+	if (lhsType !== rhsType) {
+		return linx__typeOrder.indexOf(lhsType) - linx__typeOrder.indexOf(rhsType)
+	}
+
+	switch (lhsType) {
+		case 'boolean':
+			return lhs - rhs
+		case 'number':
+			// NaN isn't ordered by `<`, so it goes after every other number
+			if (Number.isNaN(lhs) || Number.isNaN(rhs)) {
+				return Number.isNaN(lhs) - Number.isNaN(rhs)
+			}
+			return (lhs > rhs) - (lhs < rhs)
+		case 'string':
+			return lhs < rhs ? -1 : lhs > rhs ? 1 : 0
+		case 'list':
+			return lhs.length - rhs.length
+		case 'object':
+			return Object.keys(lhs).length - Object.keys(rhs).length
+		default:
+			return 0
+	}
+}
+
+function sort(list) {
+	if (type(list) !== 'list') return null
+	return [...list].sort(linx__compare)
+}
+
+function sortBy(list, compare) {
+	if (type(list) !== 'list' || type(compare) !== 'function') return null
+	return [...list].sort((lhs, rhs) => {
+		const result = compare(lhs, rhs)
+		return type(result) === 'number' ? result : 0
+	})
+}
+
+/*
+	the C runtime runs these on every core, here they run in order. reduce
+	folds the same chunks as the C runtime so the results are the same.
+*/
+const linx__parallelReduceChunk = 256
+
+const parallel = {
+	map(list, fn) {
+		if (type(list) !== 'list' || type(fn) !== 'function') return null
+		return list.map((value) => fn(value))
+	},
+	reduce(list, fn, initial) {
+		if (type(list) !== 'list' || type(fn) !== 'function') return null
+		if (list.length === 0) return initial
+
+		let result
+		for (let start = 0; start < list.length; ) {
+			const end = Math.min(start + linx__parallelReduceChunk, list.length)
+
+			// only the first chunk starts from the initial value
+			let chunk = start === 0 ? initial : list[start++]
+			for (let i = start; i < end; i++) chunk = fn(chunk, list[i])
+
+			result = end <= linx__parallelReduceChunk ? chunk : fn(result, chunk)
+			start = end
+		}
+
+		return result
+	},
+}
+
+/*
+	the file system, the same functions as the C runtime's `fs`. failures
+	return nil (or false for the functions that return a bool).
+*/
+const linx__fs = require('fs')
+const { StringDecoder: linx__StringDecoder } = require('string_decoder')
+const linx__fsChunkSize = 64 * 1024
+
+function linx__fsTry(fn, failed) {
+	try {
+		return fn()
+	} catch (error) {
+		return failed
+	}
+}
+
+const fs = {
+	readFile(path) {
+		if (type(path) !== 'string') return null
+		return linx__fsTry(() => linx__fs.readFileSync(path, 'utf-8'), null)
+	},
+	writeFile(path, content) {
+		if (type(path) !== 'string') return false
+		return linx__fsTry(() => {
+			linx__fs.writeFileSync(path, toString(content))
+			return true
+		}, false)
+	},
+	appendFile(path, content) {
+		if (type(path) !== 'string') return false
+		return linx__fsTry(() => {
+			linx__fs.appendFileSync(path, toString(content))
+			return true
+		}, false)
+	},
+	// writes are buffered & written out in chunks
+	writer(path) {
+		if (type(path) !== 'string') return null
+		let file = linx__fsTry(() => linx__fs.openSync(path, 'w'), null)
+		if (file === null) return null
+
+		let chunks = []
+		let buffered = 0
+		const flush = () => {
+			linx__fs.writeSync(file, chunks.join(''))
+			chunks = []
+			buffered = 0
+		}
+
+		return {
+			write(value) {
+				if (file === null) return false
+				const str = toString(value)
+				chunks.push(str)
+				buffered += str.length
+				if (buffered >= linx__fsChunkSize) flush()
+				return true
+			},
+			close() {
+				if (file === null) return false
+				flush()
+				linx__fs.closeSync(file)
+				file = null
+				return true
+			},
+		}
+	},
+	// lines end at "\n" or "\r\n", the file is read in as they're needed
+	lines(path) {
+		if (type(path) !== 'string') return null
+		let file = linx__fsTry(() => linx__fs.openSync(path, 'r'), null)
+		if (file === null) return null
+
+		const decoder = new linx__StringDecoder('utf-8')
+		const chunk = Buffer.alloc(linx__fsChunkSize)
+		let pending = ''
+		let done = false
+
+		// reads until a whole line (or the end of the file) is pending
+		const fill = () => {
+			while (!done && !pending.includes('\n')) {
+				const read = linx__fs.readSync(file, chunk, 0, chunk.length, null)
+				if (read === 0) {
+					pending += decoder.end()
+					linx__fs.closeSync(file)
+					done = true
+				} else {
+					pending += decoder.write(chunk.subarray(0, read))
+				}
+			}
+		}
+
+		return {
+			next() {
+				fill()
+				if (pending.length === 0) return null
+
+				let end = pending.indexOf('\n')
+				if (end === -1) end = pending.length
+				let line = pending.slice(0, end)
+				pending = pending.slice(end + 1)
+
+				return line.endsWith('\r') ? line.slice(0, -1) : line
+			},
+			valid() {
+				fill()
+				return pending.length !== 0
+			},
+		}
+	},
+	stat(path) {
+		if (type(path) !== 'string') return null
+		return linx__fsTry(() => {
+			const info = linx__fs.statSync(path)
+			return {
+				size: info.size,
+				isFile: info.isFile(),
+				isDirectory: info.isDirectory(),
+				modified: Math.floor(info.mtimeMs / 1000),
+			}
+		}, null)
+	},
+	exists(path) {
+		return type(path) === 'string' && linx__fs.existsSync(path)
+	},
+	// creates the directory & every missing parent of it
+	ensure(path) {
+		if (type(path) !== 'string') return false
+		return linx__fsTry(() => {
+			linx__fs.mkdirSync(path, { recursive: true })
+			return linx__fs.statSync(path).isDirectory()
+		}, false)
+	},
+}
+
+/*
+	the same functions as the C runtime's `lists`: `push` & `pop` change the
+	list they're given, the rest return a new list or value.
+*/
+const lists = {
+	push(list, value) {
+		if (type(list) !== 'list') return null
+		return list.push(value)
+	},
+	pop(list) {
+		if (type(list) !== 'list' || list.length === 0) return null
+		return list.pop()
+	},
+	concat(lhs, rhs) {
+		if (type(lhs) !== 'list' || type(rhs) !== 'list') return null
+		return lhs.concat(rhs)
+	},
+	// indices past either end of the list are clamped
+	slice(list, start, end) {
+		if (
+			type(list) !== 'list' ||
+			type(start) !== 'number' ||
+			type(end) !== 'number'
+		) {
+			return null
+		}
+		return list.slice(Math.max(start, 0), Math.max(end, 0))
+	},
+	reverse(list) {
+		if (type(list) !== 'list') return null
+		return [...list].reverse()
+	},
+	indexOf(list, value) {
+		if (type(list) !== 'list') return null
+		// values that aren't lists or objects are equal if they're the same
+		if (value === null || typeof value !== 'object') {
+			return list.indexOf(value)
+		}
+
+		const key = linx__key(value)
+		return list.findIndex((element) => linx__key(element) === key)
+	},
+	contains(list, value) {
+		if (type(list) !== 'list') return null
+		return lists.indexOf(list, value) !== -1
+	},
+	join(list, delimiter) {
+		if (type(list) !== 'list' || type(delimiter) !== 'string') return null
+		return list.map(toString).join(delimiter)
+	},
+	map(list, fn) {
+		if (type(list) !== 'list' || type(fn) !== 'function') return null
+		return list.map((value) => fn(value))
+	},
+	filter(list, fn) {
+		if (type(list) !== 'list' || type(fn) !== 'function') return null
+		return list.filter((value) => linx__truthy(fn(value)))
+	},
+}
+
 function linx__truthy(value) {
 	if (value === null) return false
 
@@ -102,6 +530,14 @@ function iterator(value) {
 		case 'function':
 			return null
 		case 'object': {
+			// an iterator object already is one
+			if (
+				typeof value.valid === 'function' &&
+				typeof value.next === 'function'
+			) {
+				return value
+			}
+
 			let index = 0
 			let objKeys = Object.keys(value)
 			let objVals = Object.values(value)
@@ -0,0 +1,126 @@
+const { extname } = require('path')
+const { spawnSync } = require('child_process')
+const { readFileSync, existsSync } = require('fs')
+
+const { programFiles, buildProgram } = require('./programs')
+
+// a program that doesn't finish in time has most likely hung
+const timeout = 60 * 1000
+
+/*
+	settings a test needs, from its first lines: `// cflags: ...` are extra
+	C compiler flags (e.g. a tiny nursery, to force collections) & `// env:`
+	sets environment variables (e.g. `LINX_THREADS=4`) for running it,
+	unless they're already set.
+*/
+function testSetting(source, name) {
+	const match = new RegExp(`^(?://.*\n)*?// ${name}:(.*)`).exec(source)
+	return match ? match[1].trim().split(/\s+/) : []
+}
+
+const testEnv = (source) =>
+	Object.fromEntries(
+		testSetting(source, 'env').map((variable) => variable.split('='))
+	)
+
+function run([command, args, env = {}]) {
+	const result = spawnSync(command, args, {
+		env: { ...env, ...process.env },
+		stdio: ['ignore', 'pipe', 'pipe'],
+		encoding: 'utf-8',
+		timeout,
+		maxBuffer: 64 * 1024 * 1024,
+	})
+
+	if (result.error) return { error: result.error.message }
+	if (result.status !== 0) {
+		return {
+			error: `exited with ${
+				result.signal || `status ${result.status}`
+			}\n${result.stderr}`,
+		}
+	}
+	return { stdout: result.stdout }
+}
+
+// the first line the output differs from the expected output on
+function difference(actual, expected) {
+	const actualLines = actual.split('\n')
+	const expectedLines = expected.split('\n')
+
+	for (let i = 0; i < expectedLines.length; i++) {
+		if (actualLines[i] !== expectedLines[i]) {
+			return `line ${i + 1}: expected ${JSON.stringify(
+				expectedLines[i]
+			)}, got ${JSON.stringify(actualLines[i])}`
+		}
+	}
+	return `unexpected output after line ${expectedLines.length}`
+}
+
+/*
+	runs a program with `backend`, its output has to match the `.out` file
+	next to it. returns an error message if it doesn't.
+*/
+async function testProgram(file, backend, options) {
+	const expected = file.replace(/\.li$/, '.out')
+	if (!existsSync(expected)) return `${expected} does not exist`
+
+	const source = readFileSync(file, 'utf-8')
+	let command
+	try {
+		command = await buildProgram(file, backend, {
+			prefix: 'test',
+			cc: options.cc,
+			flags: [...testSetting(source, 'cflags'), ...options.flags],
+		})
+	} catch (error) {
+		return error.message
+	}
+
+	const result = run([...command, testEnv(source)])
+	if (result.error) return result.error
+
+	const output = readFileSync(expected, 'utf-8')
+	return result.stdout === output
+		? null
+		: difference(result.stdout, output)
+}
+
+// scripts (like the optimizer's tests) pass if they exit successfully
+function testScript(file) {
+	const result = run([process.execPath, [file]])
+	return result.error || null
+}
+
+/*
+	runs every test program with each backend & every test script, resolves
+	to whether they all passed.
+*/
+async function test(paths, options) {
+	let failures = 0
+	const report = (name, error) => {
+		if (error) failures++
+		console.log(`${error ? 'FAIL' : 'ok  '} ${name}`)
+		if (error) console.log(error.replace(/^/gm, '     '))
+	}
+
+	for (const file of programFiles(paths, ['.li', '.js'])) {
+		if (extname(file) === '.js') {
+			report(file, testScript(file))
+			continue
+		}
+
+		for (const backend of options.backends) {
+			report(
+				`${file} (${backend})`,
+				await testProgram(file, backend, options)
+			)
+		}
+	}
+
+	console.log(failures === 0 ? 'all tests passed' : `${failures} failed`)
+	return failures === 0
+}
+
+module.exports = { test }
@@ -1,3 +1,5 @@
+const { createHash } = require('crypto')
+
 function createCounter(initial) {
 	let number = initial
 
@@ -8,4 +10,11 @@ function createCounter(initial) {
 	return counter
 }
 
-module.exports = { createCounter }
+// a hex digest of the given strings, used as the key of cached files
+function contentHash(...parts) {
+	let hash = createHash('sha1')
+	parts.forEach((part) => hash.update(String(part)).update('\0'))
+	return hash.digest('hex')
+}
+
+module.exports = { createCounter, contentHash }
@@ -14,4 +14,38 @@ function walk(ast, visitor) {
 	}
 }
 
-module.exports = { walk }
+/*
+	the fields of each type of node that hold other nodes (or lists of
+	them), for passes that go through the AST in place. object literals
+	hold theirs in `pairs`, as the second element of each pair.
+*/
+const childFields = {
+	// decls
+	FunctionDeclaration: ['body'],
+	VariableDeclaration: ['initializer'],
+	ConstantDeclaration: ['initializer'],
+
+	// stmts
+	ExpressionStatement: ['expression'],
+	IfStatement: ['condition', 'thenBlock', 'elseBlock'],
+	PrintStatement: ['expression'],
+	ReturnStatement: ['expression'],
+	ForStatement: ['iterable', 'body'],
+	WhileStatement: ['condition', 'body'],
+	Block: ['statements'],
+
+	// exprs
+	AssignmentExpression: ['target', 'value'],
+	BinaryExpression: ['left', 'right'],
+	UnaryExpression: ['expression'],
+	GetExpression: ['object'],
+	IndexExpression: ['array', 'index'],
+	CallExpression: ['callee', 'args'],
+	FunctionExpression: ['body'],
+	GroupExpression: ['expression'],
+
+	// literals
+	ArrayLiteral: ['values'],
+}
+
+module.exports = { walk, childFields }
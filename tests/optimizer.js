@@ -0,0 +1,350 @@
+/*
+	tests of the optimizer's passes, on the AST it produces for small
+	programs. every program is analyzed the way each backend analyzes it.
+
+	  $ node tests/optimizer.js
+*/
+
+const assert = require('assert')
+const { join } = require('path')
+
+const { Lexer } = require('../src/lexer')
+const { Parser } = require('../src/parser')
+const { bundle } = require('../src/bundler')
+const { analyzeProgram } = require('../src/analyzer')
+const { optimize } = require('../src/optimizer')
+const { childFields } = require('../src/walk')
+
+function optimized(source, compilingC) {
+	const tokens = new Lexer(source).scanTokens()
+	const ast = bundle(new Parser(tokens).parse(), join(__dirname, 'test.li'))
+	return optimize(analyzeProgram(ast, compilingC))
+}
+
+// every node in `node`, functions included
+function nodes(node, found = []) {
+	if (Array.isArray(node)) {
+		node.forEach((child) => nodes(child, found))
+		return found
+	}
+	if (!node || typeof node !== 'object' || !node.type) return found
+
+	found.push(node)
+	if (node.type === 'ObjectLiteral') {
+		node.pairs.forEach((pair) => nodes(pair[1], found))
+	} else if (node.type in childFields) {
+		childFields[node.type].forEach((field) => nodes(node[field], found))
+	}
+	return found
+}
+
+const ofType = (ast, type) => nodes(ast).filter((node) => node.type === type)
+
+function declaration(ast, name) {
+	return nodes(ast).find(
+		(node) =>
+			['VariableDeclaration', 'ConstantDeclaration'].includes(node.type) &&
+			node.ident.lexeme === name
+	)
+}
+
+const declared = (ast, name) => declaration(ast, name) !== undefined
+
+function initializer(ast, name) {
+	assert.ok(declared(ast, name), `'${name}' is declared`)
+	return declaration(ast, name).initializer
+}
+
+const hoisted = (ast) =>
+	ofType(ast, 'ConstantDeclaration').filter((node) =>
+		node.ident.lexeme.startsWith('linx__hoisted')
+	)
+
+let tests = []
+const test = (name, fn, source) => tests.push({ name, fn, source })
+
+/* <-- constant folding --> */
+
+test('folds arithmetic on number literals', (ast) => {
+	assert.deepStrictEqual(initializer(ast, 'a'), { value: 7, type: 'Literal' })
+	assert.strictEqual(initializer(ast, 'b').value, 'ab')
+	assert.strictEqual(initializer(ast, 'c').value, true)
+	assert.strictEqual(initializer(ast, 'd').value, false)
+	assert.strictEqual(initializer(ast, 'e').value, -4)
+}, `
+let a = 1 + 2 * 3
+let b = "a" + "b"
+let c = (1 < 2) and true
+let d = !(2 == 2)
+let e = -(2 + 2)
+print([a, b, c, d, e])
+`)
+
+test("leaves what the backends compute differently", (ast) => {
+	// strings are compared differently, 1 / 0 is infinity
+	assert.strictEqual(initializer(ast, 'a').type, 'BinaryExpression')
+	assert.strictEqual(initializer(ast, 'b').type, 'BinaryExpression')
+	assert.strictEqual(initializer(ast, 'c').type, 'BinaryExpression')
+	assert.strictEqual(initializer(ast, 'd').type, 'BinaryExpression')
+}, `
+let a = "a" < "b"
+let b = 1 / 0
+let c = 1 or 2
+let d = "\\\\" + "n"
+print([a, b, c, d])
+`)
+
+/* <-- dead branches --> */
+
+test('removes branches that never run', (ast) => {
+	assert.strictEqual(ofType(ast, 'IfStatement').length, 0)
+	assert.strictEqual(ofType(ast, 'WhileStatement').length, 0)
+
+	const printed = ofType(ast, 'Literal')
+		.map((node) => node.value)
+		.filter((value) => typeof value === 'string')
+	assert.deepStrictEqual(printed, ['else', 'then'])
+}, `
+if false {
+    print("if")
+} else {
+    print("else")
+}
+if 1 + 1 == 2 {
+    print("then")
+}
+if 0 {
+    print("zero")
+}
+while false {
+    print("while")
+}
+`)
+
+test('keeps loops & branches on variables', (ast) => {
+	assert.strictEqual(ofType(ast, 'IfStatement').length, 1)
+	assert.strictEqual(ofType(ast, 'WhileStatement').length, 1)
+}, `
+let x = true
+if x {
+    print(1)
+}
+while x {
+    x = false
+}
+`)
+
+/* <-- unused declarations --> */
+
+test('removes unused declarations', (ast) => {
+	assert.ok(!declared(ast, 'unused'))
+	assert.ok(!declared(ast, 'chained'))
+	assert.ok(!declared(ast, 'onlyUsedByUnused'))
+	assert.strictEqual(ofType(ast, 'FunctionDeclaration').length, 0)
+	assert.ok(declared(ast, 'used'))
+}, `
+let unused = 1 + 2
+let onlyUsedByUnused = [1, 2]
+let chained = len(onlyUsedByUnused)
+fn helper(x) {
+    return x * 2
+}
+let used = 3
+print(used)
+`)
+
+test('keeps declarations whose initializer has side effects', (ast) => {
+	assert.ok(declared(ast, 'result'))
+	assert.ok(declared(ast, 'pushed'))
+	assert.ok(declared(ast, 'names'))
+	assert.strictEqual(ofType(ast, 'FunctionDeclaration').length, 1)
+}, `
+let calls = 0
+fn count() {
+    calls = calls + 1
+    return calls
+}
+let xs = [1]
+let result = count()
+let pushed = lists.push(xs, 2)
+let names = keys(count())
+print(calls)
+`)
+
+test('keeps declarations that could fail', (ast) => {
+	assert.ok(declared(ast, 'missing'))
+	assert.ok(declared(ast, 'outOfRange'))
+	assert.ok(declared(ast, 'sum'))
+	assert.ok(declared(ast, 'negated'))
+	assert.ok(!declared(ast, 'arithmetic'))
+}, `
+let obj = {a: 1}
+let xs = [1]
+let missing = obj.missing
+let outOfRange = xs[100]
+let sum = obj + xs
+let negated = -obj
+let arithmetic = (1 / 0) * -(2 - 3) < 4
+print(1)
+`)
+
+test('keeps variables captured by a closure', (ast) => {
+	assert.ok(declared(ast, 'captured'))
+}, `
+let captured = 1
+let f = fn () {
+    return captured
+}
+print(f())
+`)
+
+/* <-- loop invariant calls --> */
+
+test('hoists invariant len, type & toString calls', (ast) => {
+	// `toString(len(xs))` is hoisted once `len(xs)` is
+	const calls = hoisted(ast).map((node) => node.initializer.callee.builtin)
+	assert.deepStrictEqual(calls.sort(), ['len', 'toString', 'toString', 'type'])
+
+	// the loop's condition reads the hoisted constant instead
+	const [loop] = ofType(ast, 'WhileStatement')
+	assert.strictEqual(loop.condition.right.type, 'VariableExpression')
+	assert.ok(loop.condition.right.ident.lexeme.startsWith('linx__hoisted'))
+}, `
+let xs = [1, 2, 3]
+let name = "linx"
+let i = 0
+while i < len(xs) {
+    print(type(name) + toString(xs) + toString(len(xs)))
+    i = i + 1
+}
+`)
+
+test('identical calls share a hoisted constant', (ast) => {
+	assert.strictEqual(hoisted(ast).length, 1)
+}, `
+let xs = [1, 2, 3]
+let i = 0
+while i < len(xs) {
+    print(len(xs) - i)
+    i = i + 1
+}
+`)
+
+test('hoists out of for loops', (ast) => {
+	assert.strictEqual(hoisted(ast).length, 1)
+}, `
+let xs = [1, 2, 3]
+for i in 0..10 {
+    print(i * len(xs))
+}
+`)
+
+/* <-- loops nothing is hoisted out of --> */
+
+test("doesn't hoist calls on variables the loop assigns", (ast) => {
+	assert.strictEqual(hoisted(ast).length, 0)
+}, `
+let xs = [1, 2, 3]
+while len(xs) < 10 {
+    xs = xs + [1]
+}
+`)
+
+test("doesn't hoist out of for loops over an iterator object", (ast) => {
+	assert.strictEqual(hoisted(ast).length, 0)
+}, `
+let xs = [1, 2, 3]
+let count = {
+    valid: fn () { return len(xs) < 5 },
+    next: fn () {
+        xs = xs + [0]
+        return len(xs)
+    }
+}
+for i in count {
+    print(i * len(xs))
+}
+`)
+
+test("doesn't hoist out of loops that assign into a list or object", (ast) => {
+	assert.strictEqual(hoisted(ast).length, 0)
+}, `
+let xs = [1, 2, 3]
+let ys = xs
+let i = 0
+while i < len(xs) {
+    ys[0] = i
+    i = i + 1
+}
+`)
+
+test("doesn't hoist out of loops that call functions", (ast) => {
+	assert.strictEqual(hoisted(ast).length, 0)
+}, `
+let xs = [1, 2, 3]
+fn grow() {
+    xs = xs + [1]
+}
+let i = 0
+while i < len(xs) {
+    grow()
+    i = i + 1
+}
+`)
+
+test("doesn't hoist out of loops that call builtins with a callback", (ast) => {
+	assert.strictEqual(hoisted(ast).length, 0)
+}, `
+let count = ""
+let compare = fn (a, b) {
+    count = count + "a"
+    return a - b
+}
+while len(count) < 10 {
+    sortBy([3, 1, 2], compare)
+}
+`)
+
+test("doesn't hoist out of loops that call functions of builtin objects", (ast) => {
+	assert.strictEqual(hoisted(ast).length, 0)
+}, `
+let count = ""
+while len(count) < 10 {
+    lists.map([1, 2], fn (x) {
+        count = count + "b"
+        return x
+    })
+}
+`)
+
+test("doesn't hoist calls that could fail & might not run", (ast) => {
+	assert.strictEqual(hoisted(ast).length, 0)
+}, `
+let xs = []
+let i = 0
+while i < 10 {
+    if i > 20 {
+        print(len(xs[0]))
+    }
+    i = i + 1
+}
+`)
+
+let failed = 0
+tests.forEach(({ name, fn, source }) => {
+	for (const compilingC of [true, false]) {
+		try {
+			fn(optimized(source, compilingC))
+		} catch (error) {
+			failed++
+			console.error(`FAIL ${name} (${compilingC ? 'c' : 'js'})`)
+			console.error(error.message)
+		}
+	}
+})
+
+if (failed > 0) {
+	console.error(`${failed} of ${tests.length * 2} failed`)
+	process.exit(1)
+}
+console.log(`${tests.length * 2} passed`)